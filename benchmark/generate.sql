@@ -0,0 +1,38 @@
+-- Populates the Bigtable emulator with the data read by the benchmarks in this directory:
+--   product: 2000 pe_ids x 20 shops x 14 days (ISO weeks 2024_20 and 2024_21), with prices, a promo on
+--            every tenth pe_id and two shelves per day, the second one paid on every fifth pe_id
+--   search:  10 keywords x 4 shops x 168 hours (ISO week 2024_45) x 200 positions, every eighth position
+--            holding a retailer id instead of a pe_id and the first four positions paid
+-- Run with `just bench_data` once `just emulator` is up.
+
+SET bigtable_emulator_host = 'localhost:8086';
+
+SELECT sum(rows_written) AS product_rows
+FROM bigtable_write((
+    SELECT
+        (1124000100000 + p)::UBIGINT AS pe_id,
+        (41188 + s)::UINTEGER AS shop_id,
+        DATE '2024-05-13' + d::INTEGER AS date,
+        (1 + (p * 7 + s * 3 + d) % 500 / 10)::FLOAT AS price,
+        (1 + (p * 7 + s * 3) % 500 / 10)::FLOAT AS base_price,
+        ((p * 7 + s * 3 + d) % 500 / 25)::FLOAT AS unit_price,
+        CASE WHEN p % 10 = 0 THEN (p % 1000)::UINTEGER END AS promo_id,
+        CASE WHEN p % 10 = 0 THEN '2 for 1 on brand ' || p % 50 END AS promo_text,
+        ['shelf_' || p % 30, 'shelf_' || (30 + (p + s) % 30)] AS shelf_id,
+        [(1 + (p + d) % 48)::USMALLINT, (1 + (p * 3 + d) % 48)::USMALLINT] AS position,
+        [false, p % 5 = 0] AS is_paid
+    FROM range(2000) t_p(p), range(20) t_s(s), range(14) t_d(d)
+), 'product', batch_size := 5000, max_inflight := 16);
+
+SELECT sum(rows_written) AS search_rows
+FROM bigtable_write((
+    SELECT
+        (98334 + k)::UINTEGER AS keyword_id,
+        (131693 + s)::UINTEGER AS shop_id,
+        TIMESTAMP '2024-11-04' + to_hours(h) AS date,
+        (pos + 1)::UTINYINT AS position,
+        CASE WHEN pos % 8 <> 7 THEN (1124000100000 + (k * 997 + h * 31 + pos) % 2000)::UBIGINT END AS pe_id,
+        CASE WHEN pos % 8 = 7 THEN ((k * 997 + pos) % 5000)::VARCHAR END AS retailer_p_id,
+        pos < 4 AS is_paid
+    FROM range(10) t_k(k), range(4) t_s(s), range(168) t_h(h), range(200) t_pos(pos)
+), 'search', batch_size := 5000, max_inflight := 16);
@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# Runs the `run` query of each benchmark against the emulator and reports Bigtable rows/s, bytes/s and the
+# peak resident memory of the process, read from bigtable_metrics() and GNU time.
+set -euo pipefail
+
+DUCKDB=${DUCKDB:-./build/release/duckdb}
+EMULATOR_HOST=${EMULATOR_HOST:-localhost:8086}
+
+printf "%-28s %12s %10s %14s %14s %12s\n" benchmark result_rows seconds bt_rows/s MB/s peak_MB
+for benchmark in "${@:-benchmark/*.benchmark}"; do
+	for file in $benchmark; do
+		query=$(awk '/^run$/ { run = 1; next } run && /^$/ { exit } run { print }' "$file" | sed 's/;$//')
+		stats=$(mktemp)
+		report=$(/usr/bin/time -f "%M" -o "$stats" "$DUCKDB" --init /dev/null -list -noheader \
+			-c "SET bigtable_emulator_host = '$EMULATOR_HOST'" \
+			-c "FROM bigtable_metrics_reset()" \
+			-c "CREATE TEMP TABLE result AS $query" \
+			-c "SELECT (SELECT count(*) FROM result)::VARCHAR || ' ' || string_agg(value::VARCHAR, ' ' ORDER BY metric)
+			    FROM bigtable_metrics() WHERE metric IN ('uptime_s', 'rows', 'bytes')" | tail -n 1)
+		read -r result_rows bytes rows seconds <<<"$report"
+		awk -v name="$(basename "$file" .benchmark)" -v result_rows="$result_rows" -v seconds="$seconds" \
+			-v rows="$rows" -v bytes="$bytes" -v peak_kb="$(tail -n 1 "$stats")" 'BEGIN {
+			printf "%-28s %12d %10.3f %14.0f %14.2f %12.1f\n", name, result_rows, seconds, rows / seconds,
+			       bytes / seconds / 1e6, peak_kb / 1024
+		}'
+		rm -f "$stats"
+	done
+done
@@ -0,0 +1,238 @@
+#!/usr/bin/python3
+"""
+Writes test/data/bigtable2.rec, the ReadRows responses replayed by test/sql/bigtable2.test.
+
+Each entry is keyed like src/replay.cpp keys a request: table name, serialized RowSet, serialized RowFilter, rows
+limit and direction, single-row reads being keyed as a ReadRows of their key limited to one row. The rows of an entry
+are those Bigtable returns for that request, so they already went through its filter (values stripped, families left
+out). The data set is:
+
+  product  pe_id 1124000100000, ISO week 2024_20
+    shop 41188  Mon: price 2.5, base 3, unit 0.5, promo 17, shelf_1 at 3, shelf_2 at 1 (paid)
+                Tue: price 2, base 3, shelf_1 at 4
+    shop 41189  Mon: promo 17 only
+                Wed: price 4
+  search   keyword 98334, shop 131693, ISO week 2024_45
+                Mon 10h: pe_id at 1 (paid), retailer A7 at 2, pe_id at 3
+                Mon 11h: pe_id at 1
+                Tue 09h: pe_id at 4 (09:00), pe_id at 1 (09:30)
+           keyword 98334, shop 131694, ISO week 2024_45
+                Mon 10h: retailer B2 at 1, pe_id at 2
+
+Run from the repository root after changing the data or a filter: scripts/make-test-record.py
+"""
+
+import struct
+from datetime import datetime, timezone
+from pathlib import Path
+
+PROJECT = "dataimpact-processing"
+INSTANCE = "processing"
+RECORD_MAGIC = b"BTREC1\n"
+
+
+# Protocol buffer encoding of the google.bigtable.v2 messages making up a request key
+
+
+def varint(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def field_bytes(number: int, value) -> bytes:
+    if isinstance(value, str):
+        value = value.encode()
+    return varint(number << 3 | 2) + varint(len(value)) + value
+
+
+def field_bool(number: int) -> bytes:
+    return varint(number << 3) + b"\x01"
+
+
+def closed_range(start: str, end: str) -> bytes:
+    return field_bytes(1, start) + field_bytes(4, end)
+
+
+def prefix_range(prefix: str) -> bytes:
+    end = prefix[:-1] + chr(ord(prefix[-1]) + 1)
+    return field_bytes(1, prefix) + field_bytes(3, end)
+
+
+def row_set(ranges=(), keys=()) -> bytes:
+    return b"".join(field_bytes(1, key) for key in keys) + b"".join(field_bytes(2, r) for r in ranges)
+
+
+def chain(*filters) -> bytes:
+    return field_bytes(1, b"".join(field_bytes(1, f) for f in filters))
+
+
+def interleave(*filters) -> bytes:
+    return field_bytes(2, b"".join(field_bytes(1, f) for f in filters))
+
+
+def family_regex(regex: str) -> bytes:
+    return field_bytes(5, regex)
+
+
+def column_regex(regex: str) -> bytes:
+    return field_bytes(6, regex)
+
+
+def column_range_closed(family: str, start: str, end: str) -> bytes:
+    return field_bytes(7, field_bytes(1, family) + field_bytes(2, start) + field_bytes(4, end))
+
+
+PASS_ALL = field_bool(17)
+STRIP_VALUE = field_bool(13)
+
+
+def request_key(table: str, rows: bytes, row_filter: bytes, rows_limit: int = 0) -> bytes:
+    table_name = f"projects/{PROJECT}/instances/{INSTANCE}/tables/{table}".encode()
+    return table_name + b"\0" + rows + b"\0" + row_filter + b"\0" + str(rows_limit).encode() + b"f"
+
+
+# Rows, as (row key, [(family, qualifier, timestamp, value)])
+
+
+def micros(*args) -> int:
+    return int(datetime(*args, tzinfo=timezone.utc).timestamp()) * 1_000_000
+
+
+MON, TUE, WED = micros(2024, 5, 13), micros(2024, 5, 14), micros(2024, 5, 15)
+
+PRODUCT_41188 = (
+    "0000010004211/202420/41188",
+    [
+        ("S", "shelf_2", MON, "1"),
+        ("d", "17", MON, "2 for 1"),
+        ("p", "b", TUE, "3"),
+        ("p", "b", MON, "3"),
+        ("p", "p", TUE, "2"),
+        ("p", "p", MON, "2.5"),
+        ("p", "u", MON, "0.5"),
+        ("s", "shelf_1", TUE, "4"),
+        ("s", "shelf_1", MON, "3"),
+    ],
+)
+PRODUCT_41189 = (
+    "0000010004211/202420/41189",
+    [
+        ("d", "17", MON, "2 for 1"),
+        ("p", "p", WED, "4"),
+    ],
+)
+
+MON_10, MON_11 = micros(2024, 11, 4, 10), micros(2024, 11, 4, 11)
+TUE_09, TUE_0930 = micros(2024, 11, 5, 9), micros(2024, 11, 5, 9, 30)
+
+SEARCH_131693 = (
+    "43389/202445/131693",
+    [
+        ("p", "1", TUE_0930, "1124000100000"),
+        ("p", "1", MON_11, "1124000100001"),
+        ("p", "1", MON_10, "1124000100000"),
+        ("p", "2", MON_10, "id_ret_A7"),
+        ("p", "3", MON_10, "1124000100001"),
+        ("p", "4", TUE_09, "1124000100002"),
+        ("s", "1", MON_10, "1"),
+    ],
+)
+SEARCH_131694 = (
+    "43389/202445/131694",
+    [
+        ("p", "1", MON_10, "id_ret_B2"),
+        ("p", "2", MON_10, "1124000100000"),
+    ],
+)
+
+
+def apply(row, keep=lambda cell: True, strip=lambda cell: False):
+    key, cells = row
+    kept = [(f, q, ts, "" if strip((f, q, ts, v)) else v) for f, q, ts, v in cells if keep((f, q, ts, v))]
+    return [(key, kept)] if kept else []
+
+
+def entries():
+    product_span = row_set([closed_range("0000010004211/202420/", "0000010004211/2024200")])
+    both = (PRODUCT_41188, PRODUCT_41189)
+
+    # product with every column, over the span and for a list of shops with price and promo columns only
+    yield request_key("product", product_span, PASS_ALL), [r for row in both for r in apply(row)]
+    for row in (PRODUCT_41189, PRODUCT_41188):
+        yield request_key("product", row_set([closed_range(row[0], row[0])]), family_regex("d|p")), apply(
+            row, lambda cell: cell[0] in "dp"
+        )
+
+    # product_shelves, without and with shelf_id = 'shelf_1' pushed down
+    shelves = lambda cell: cell[0] in "sS"
+    yield request_key("product", product_span, family_regex("s|S")), [r for row in both for r in apply(row, shelves)]
+    yield request_key("product", product_span, chain(family_regex("s|S"), column_regex("shelf_1"))), [
+        r for row in both for r in apply(row, lambda cell: shelves(cell) and cell[1] == "shelf_1")
+    ]
+
+    # product_agg
+    agg_filter = interleave(chain(family_regex("p"), column_regex("p")), chain(family_regex("d"), STRIP_VALUE))
+    yield request_key("product", product_span, agg_filter), [
+        r
+        for row in both
+        for r in apply(row, lambda cell: cell[0] == "d" or cell[:2] == ("p", "p"), lambda cell: cell[0] == "d")
+    ]
+
+    # bigtable_scan of price and promo, with both projected and with price stripped
+    scan_rows = row_set([prefix_range("0000010004211/202420/41188")])
+    scan_cell = lambda cell: cell[:2] in (("p", "p"), ("d", "17"))
+    price = column_range_closed("p", "p", "p")
+    promo = column_range_closed("d", "17", "17")
+    yield request_key("product", scan_rows, interleave(price, promo)), apply(PRODUCT_41188, scan_cell)
+    yield request_key("product", scan_rows, interleave(promo, chain(price, STRIP_VALUE))), apply(
+        PRODUCT_41188, scan_cell, lambda cell: cell[0] == "p"
+    )
+
+    # bigtable_cells, with family = 'd' pushed down and without the value column
+    cells_rows = row_set([prefix_range("0000010004211/202420/41189")])
+    yield request_key("product", cells_rows, family_regex("d")), apply(PRODUCT_41189, lambda cell: cell[0] == "d")
+    yield request_key("product", cells_rows, STRIP_VALUE), apply(PRODUCT_41189, strip=lambda cell: True)
+
+    # product_lookup reads each distinct key of its input with a single-row read, keyed like a one-row ReadRows
+    for row in both:
+        yield request_key("product", row_set(keys=[row[0]]), PASS_ALL, 1), apply(row)
+
+    # search, search_agg and search_ranked read the point range of each shop with every family
+    for row in (SEARCH_131693, SEARCH_131694):
+        yield request_key("search", row_set([closed_range(row[0], row[0])]), PASS_ALL), apply(row)
+
+
+def write_string(out: bytearray, value):
+    if isinstance(value, str):
+        value = value.encode()
+    out += struct.pack("<I", len(value)) + value
+
+
+def main():
+    out = bytearray(RECORD_MAGIC)
+    for key, rows in entries():
+        write_string(out, key)
+        out += struct.pack("<I", len(rows))
+        for row_key, cells in rows:
+            write_string(out, row_key)
+            out += struct.pack("<I", len(cells))
+            for family, qualifier, timestamp, value in cells:
+                write_string(out, family)
+                write_string(out, qualifier)
+                out += struct.pack("<q", timestamp)
+                write_string(out, value)
+
+    path = Path(__file__).resolve().parent.parent / "test" / "data" / "bigtable2.rec"
+    path.parent.mkdir(parents=True, exist_ok=True)
+    path.write_bytes(bytes(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,7 +1,15 @@
 #define DUCKDB_EXTENSION_MAIN
 
+#include "cells.hpp"
+#include "config.hpp"
+#include "metrics.hpp"
 #include "product.hpp"
+#include "product_agg.hpp"
+#include "product_shelves.hpp"
+#include "scan.hpp"
 #include "search.hpp"
+#include "search_agg.hpp"
+#include "write.hpp"
 #include "bigtable2_extension.hpp"
 #include "duckdb.hpp"
 #include "duckdb/common/exception.hpp"
@@ -11,13 +19,18 @@
 namespace duckdb {
 
 static void LoadInternal(ExtensionLoader &loader) {
+	RegisterBigtableConfig(loader);
+
 	{
 		TableFunction product("product", 
 			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT)},
 	    	ProductFunction, ProductFunctionBind, ProductInitGlobal, ProductInitLocal);
 		product.projection_pushdown = true;
+		product.sampling_pushdown = true;
 		product.table_scan_progress = ProductScanProgress;
 		product.statistics = ProductStatistics;
+		product.cardinality = ProductCardinality;
+		product.dynamic_to_string = ProductDynamicToString;
 		loader.RegisterFunction(product);
 	}
 	{
@@ -25,17 +38,56 @@ static void LoadInternal(ExtensionLoader &loader) {
 			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT), LogicalType::LIST(LogicalType::BIGINT)},
 	    	ProductFunction, ProductFunctionBind, ProductInitGlobal, ProductInitLocal);
 		product.projection_pushdown = true;
+		product.sampling_pushdown = true;
 		product.table_scan_progress = ProductScanProgress;
 		product.statistics = ProductStatistics;
+		product.cardinality = ProductCardinality;
+		product.dynamic_to_string = ProductDynamicToString;
 		loader.RegisterFunction(product);
 	}
+	{
+		TableFunction lookup("product_lookup", {LogicalType::TABLE}, nullptr, ProductLookupFunctionBind,
+		                     ProductLookupInitGlobal, ProductLookupInitLocal);
+		lookup.in_out_function = ProductLookupFunction;
+		lookup.in_out_function_final = ProductLookupFunctionFinal;
+		lookup.named_parameters["max_inflight"] = LogicalType::UBIGINT;
+		loader.RegisterFunction(lookup);
+	}
+	{
+		TableFunction shelves("product_shelves",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT)},
+			ProductShelvesFunction, ProductShelvesFunctionBind, ProductShelvesInitGlobal, ProductShelvesInitLocal);
+		shelves.projection_pushdown = true;
+		shelves.sampling_pushdown = true;
+		shelves.filter_pushdown = true;
+		shelves.table_scan_progress = ProductShelvesScanProgress;
+		shelves.dynamic_to_string = ProductShelvesDynamicToString;
+		loader.RegisterFunction(shelves);
+	}
+	{
+		TableFunction shelves("product_shelves",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT), LogicalType::LIST(LogicalType::BIGINT)},
+			ProductShelvesFunction, ProductShelvesFunctionBind, ProductShelvesInitGlobal, ProductShelvesInitLocal);
+		shelves.projection_pushdown = true;
+		shelves.sampling_pushdown = true;
+		shelves.filter_pushdown = true;
+		shelves.table_scan_progress = ProductShelvesScanProgress;
+		shelves.dynamic_to_string = ProductShelvesDynamicToString;
+		loader.RegisterFunction(shelves);
+	}
 	{
 		TableFunction search("search",
 			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER)},
 			SearchFunction, SearchFunctionBind, SearchInitGlobal, SearchInitLocal);
 		search.projection_pushdown = true;
+		search.sampling_pushdown = true;
 		search.table_scan_progress = SearchScanProgress;
 		search.statistics = SearchStatistics;
+		search.cardinality = SearchCardinality;
+		search.get_partition_info = SearchPartitionInfo;
+		search.get_partition_data = SearchPartitionData;
+		search.named_parameters["ordered"] = LogicalType::BOOLEAN;
+		search.dynamic_to_string = SearchDynamicToString;
 		loader.RegisterFunction(search);
 	}
 	{
@@ -43,10 +95,121 @@ static void LoadInternal(ExtensionLoader &loader) {
 			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER), LogicalType::LIST(LogicalType::BIGINT)},
 			SearchFunction, SearchFunctionBind, SearchInitGlobal, SearchInitLocal);
 		search.projection_pushdown = true;
+		search.sampling_pushdown = true;
 		search.table_scan_progress = SearchScanProgress;
 		search.statistics = SearchStatistics;
+		search.cardinality = SearchCardinality;
+		search.get_partition_info = SearchPartitionInfo;
+		search.get_partition_data = SearchPartitionData;
+		search.named_parameters["ordered"] = LogicalType::BOOLEAN;
+		search.dynamic_to_string = SearchDynamicToString;
 		loader.RegisterFunction(search);
 	}
+	{
+		TableFunction agg("product_agg",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT)},
+			ProductAggFunction, ProductAggFunctionBind, ProductAggInitGlobal, ProductAggInitLocal);
+		agg.projection_pushdown = true;
+		agg.table_scan_progress = ProductAggScanProgress;
+		agg.dynamic_to_string = ProductAggDynamicToString;
+		loader.RegisterFunction(agg);
+	}
+	{
+		TableFunction agg("product_agg",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::BIGINT), LogicalType::LIST(LogicalType::BIGINT)},
+			ProductAggFunction, ProductAggFunctionBind, ProductAggInitGlobal, ProductAggInitLocal);
+		agg.projection_pushdown = true;
+		agg.table_scan_progress = ProductAggScanProgress;
+		agg.dynamic_to_string = ProductAggDynamicToString;
+		loader.RegisterFunction(agg);
+	}
+	{
+		TableFunction ranked("search_ranked",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER)},
+			SearchRankedFunction, SearchRankedFunctionBind, SearchRankedInitGlobal, SearchRankedInitLocal);
+		ranked.projection_pushdown = true;
+		ranked.sampling_pushdown = true;
+		ranked.table_scan_progress = SearchScanProgress;
+		ranked.cardinality = SearchRankedCardinality;
+		ranked.dynamic_to_string = SearchDynamicToString;
+		loader.RegisterFunction(ranked);
+	}
+	{
+		TableFunction ranked("search_ranked",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER), LogicalType::LIST(LogicalType::BIGINT)},
+			SearchRankedFunction, SearchRankedFunctionBind, SearchRankedInitGlobal, SearchRankedInitLocal);
+		ranked.projection_pushdown = true;
+		ranked.sampling_pushdown = true;
+		ranked.table_scan_progress = SearchScanProgress;
+		ranked.cardinality = SearchRankedCardinality;
+		ranked.dynamic_to_string = SearchDynamicToString;
+		loader.RegisterFunction(ranked);
+	}
+	{
+		TableFunction agg("search_agg",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER)},
+			SearchAggFunction, SearchAggFunctionBind, SearchAggInitGlobal, SearchAggInitLocal);
+		agg.projection_pushdown = true;
+		agg.table_scan_progress = SearchAggScanProgress;
+		agg.dynamic_to_string = SearchAggDynamicToString;
+		loader.RegisterFunction(agg);
+	}
+	{
+		TableFunction agg("search_agg",
+			{LogicalType::INTEGER, LogicalType::INTEGER, LogicalType::LIST(LogicalType::INTEGER), LogicalType::LIST(LogicalType::BIGINT)},
+			SearchAggFunction, SearchAggFunctionBind, SearchAggInitGlobal, SearchAggInitLocal);
+		agg.projection_pushdown = true;
+		agg.table_scan_progress = SearchAggScanProgress;
+		agg.dynamic_to_string = SearchAggDynamicToString;
+		loader.RegisterFunction(agg);
+	}
+	{
+		TableFunction scan("bigtable_scan",
+			{LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::LIST(LogicalType::VARCHAR)},
+			BigtableScanFunction, BigtableScanFunctionBind, BigtableScanInitGlobal, BigtableScanInitLocal);
+		scan.projection_pushdown = true;
+		scan.table_scan_progress = BigtableScanProgress;
+		scan.dynamic_to_string = BigtableScanDynamicToString;
+		scan.named_parameters["columns"] = LogicalType::ANY;
+		loader.RegisterFunction(scan);
+	}
+	{
+		TableFunction cells("bigtable_cells", {LogicalType::VARCHAR, LogicalType::VARCHAR},
+			CellsFunction, CellsFunctionBind, CellsInitGlobal, CellsInitLocal);
+		cells.projection_pushdown = true;
+		cells.filter_pushdown = true;
+		cells.table_scan_progress = CellsScanProgress;
+		cells.dynamic_to_string = CellsDynamicToString;
+		loader.RegisterFunction(cells);
+	}
+	{
+		TableFunction cells("bigtable_cells", {LogicalType::VARCHAR, LogicalType::LIST(LogicalType::VARCHAR)},
+			CellsFunction, CellsFunctionBind, CellsInitGlobal, CellsInitLocal);
+		cells.projection_pushdown = true;
+		cells.filter_pushdown = true;
+		cells.table_scan_progress = CellsScanProgress;
+		cells.dynamic_to_string = CellsDynamicToString;
+		loader.RegisterFunction(cells);
+	}
+	{
+		TableFunction write("bigtable_write", {LogicalType::TABLE, LogicalType::VARCHAR}, nullptr, WriteFunctionBind,
+		                    WriteInitGlobal, WriteInitLocal);
+		write.in_out_function = WriteFunction;
+		write.in_out_function_final = WriteFunctionFinal;
+		write.named_parameters["layout"] = LogicalType::VARCHAR;
+		write.named_parameters["batch_size"] = LogicalType::UBIGINT;
+		write.named_parameters["max_inflight"] = LogicalType::UBIGINT;
+		loader.RegisterFunction(write);
+	}
+	{
+		TableFunction metrics("bigtable_metrics", {}, MetricsFunction, MetricsFunctionBind, MetricsInitGlobal);
+		loader.RegisterFunction(metrics);
+	}
+	{
+		TableFunction metrics_reset("bigtable_metrics_reset", {}, MetricsResetFunction, MetricsResetFunctionBind,
+		                            MetricsResetInitGlobal);
+		loader.RegisterFunction(metrics_reset);
+	}
 }
 
 void Bigtable2Extension::Load(ExtensionLoader &loader) {
@@ -0,0 +1,102 @@
+#include "cardinality.hpp"
+
+#include "duckdb.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+namespace duckdb {
+
+// Weight of the latest scan in the estimate, so that it follows a table as it grows without jumping on one outlier
+static constexpr double LEARNING_RATE = 0.25;
+
+// Reads an estimate file, one `key<TAB>rows per range and week` line per table and kind of range. A missing or
+// unreadable file holds no estimates.
+static unordered_map<string, double> ReadEstimates(const string &path) {
+	unordered_map<string, double> estimates;
+	std::ifstream file(path);
+	string line;
+	while (std::getline(file, line)) {
+		const auto tab = line.rfind('\t');
+		if (tab == string::npos) {
+			continue;
+		}
+		char *end;
+		const auto value = std::strtod(line.c_str() + tab + 1, &end);
+		if (end != line.c_str() + tab + 1) {
+			estimates[line.substr(0, tab)] = value;
+		}
+	}
+	return estimates;
+}
+
+// Rewrites the estimate file with `key` updated, through a renamed temporary file so that concurrent readers never
+// see a partial file. Estimates only size scans, so a file that cannot be written is left as it is.
+static void WriteEstimate(const string &path, const string &key, double rows_per_range_week) {
+	static mutex lock;
+	lock_guard<mutex> guard(lock);
+
+	auto estimates = ReadEstimates(path);
+	estimates[key] = rows_per_range_week;
+
+	const auto temp_path = path + "." + std::to_string(std::random_device {}()) + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::trunc);
+		for (const auto &estimate : estimates) {
+			file << estimate.first << '\t' << std::to_string(estimate.second) << '\n';
+		}
+		if (!file.flush()) {
+			std::remove(temp_path.c_str());
+			return;
+		}
+	}
+	if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+		std::remove(temp_path.c_str());
+	}
+}
+
+RowEstimate &RowEstimate::Get(const BigtableConfig &config, const string &kind) {
+	static mutex lock;
+	static unordered_map<string, unique_ptr<RowEstimate>> estimates;
+
+	const auto key = config.emulator_host + "/" + config.replay_path + "/" + config.project + "/" + config.instance +
+	                 "/" + config.table_id + "/" + kind;
+	lock_guard<mutex> guard(lock);
+	auto &estimate = estimates[config.estimate_path + "\t" + key];
+	if (!estimate) {
+		estimate = make_uniq<RowEstimate>(config.estimate_path, key);
+		if (!config.estimate_path.empty()) {
+			const auto stored = ReadEstimates(config.estimate_path);
+			const auto entry = stored.find(key);
+			if (entry != stored.end()) {
+				estimate->rows_per_range_week = entry->second;
+			}
+		}
+	}
+	return *estimate;
+}
+
+std::optional<double> RowEstimate::RowsPerRangeWeek() const {
+	lock_guard<mutex> guard(lock);
+	return rows_per_range_week;
+}
+
+void RowEstimate::Learn(idx_t range_weeks, idx_t rows) {
+	if (range_weeks == 0) {
+		return;
+	}
+	const auto sample = static_cast<double>(rows) / static_cast<double>(range_weeks);
+	double learned;
+	{
+		lock_guard<mutex> guard(lock);
+		rows_per_range_week =
+		    rows_per_range_week ? *rows_per_range_week + LEARNING_RATE * (sample - *rows_per_range_week) : sample;
+		learned = *rows_per_range_week;
+	}
+	if (!path.empty()) {
+		WriteEstimate(path, key, learned);
+	}
+}
+
+} // namespace duckdb
@@ -0,0 +1,340 @@
+#include "cells.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "filters.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+enum CellsColumn : column_t { ROW_KEY = 0, FAMILY = 1, QUALIFIER = 2, TIMESTAMP = 3, VALUE = 4 };
+
+struct CellsFunctionData : TableFunctionData {
+	BigtableConfig config;
+	vector<cbt::RowRange> ranges;
+};
+
+static const vector<LogicalType> &CellsTypes() {
+	static const vector<LogicalType> types = {LogicalType::VARCHAR, LogicalType::VARCHAR, LogicalType::VARCHAR,
+	                                          LogicalType::TIMESTAMP, LogicalType::BLOB};
+	return types;
+}
+
+unique_ptr<FunctionData> CellsFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                           vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"row_key", "family", "qualifier", "timestamp", "value"};
+	return_types = CellsTypes();
+
+	auto bind_data = make_uniq<CellsFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, StringValue::Get(input.inputs[0]));
+
+	if (input.inputs[1].type().id() == LogicalTypeId::LIST) {
+		for (const auto &prefix : ListValue::GetChildren(input.inputs[1])) {
+			bind_data->ranges.emplace_back(cbt::RowRange::Prefix(StringValue::Get(prefix)));
+		}
+	} else {
+		bind_data->ranges.emplace_back(cbt::RowRange::Prefix(StringValue::Get(input.inputs[1])));
+	}
+
+	return bind_data;
+}
+
+// Narrows the ranges to the row keys allowed by the filters on row_key, dropping the ranges left empty.
+static vector<cbt::RowRange> RestrictRanges(const vector<cbt::RowRange> &ranges, const FilterBounds &bounds) {
+	if (bounds.lower.IsNull() && bounds.upper.IsNull()) {
+		return ranges;
+	}
+
+	const auto lower = bounds.lower.IsNull() ? string() : StringValue::Get(bounds.lower);
+	const auto upper = bounds.upper.IsNull() ? string() : StringValue::Get(bounds.upper);
+	cbt::RowRange key_range = cbt::RowRange::InfiniteRange();
+	if (!bounds.lower.IsNull() && !bounds.upper.IsNull()) {
+		if (bounds.lower_inclusive) {
+			key_range = bounds.upper_inclusive ? cbt::RowRange::Closed(lower, upper)
+			                                   : cbt::RowRange::RightOpen(lower, upper);
+		} else {
+			key_range = bounds.upper_inclusive ? cbt::RowRange::LeftOpen(lower, upper)
+			                                   : cbt::RowRange::Open(lower, upper);
+		}
+	} else if (!bounds.lower.IsNull()) {
+		key_range = bounds.lower_inclusive ? cbt::RowRange::StartingAt(lower) : cbt::RowRange::Open(lower, "");
+	} else {
+		key_range = bounds.upper_inclusive ? cbt::RowRange::EndingAt(upper) : cbt::RowRange::RightOpen("", upper);
+	}
+
+	vector<cbt::RowRange> result;
+	for (const auto &range : ranges) {
+		auto intersection = range.Intersect(key_range);
+		if (intersection.first) {
+			result.emplace_back(std::move(intersection.second));
+		}
+	}
+	return result;
+}
+
+static int64_t GetMicros(const Value &value) {
+	return Timestamp::GetEpochMicroSeconds(value.GetValue<timestamp_t>());
+}
+
+// Translates the pushed filters into a Bigtable filter. Bigtable timestamps have millisecond granularity,
+// so timestamp bounds are widened to whole milliseconds and left to the exact client-side filter.
+static cbt::Filter MakeCellsFilter(optional_ptr<TableFilterSet> table_filters, const vector<column_t> &column_ids,
+                                   const vector<cbt::RowRange> &bind_ranges, vector<cbt::RowRange> &ranges) {
+	ranges = bind_ranges;
+	vector<cbt::Filter> filters;
+
+	if (table_filters) {
+		FilterBounds family_bounds, qualifier_bounds;
+		for (const auto &entry : table_filters->filters) {
+			const auto bounds = GetFilterBounds(*entry.second);
+			switch (static_cast<CellsColumn>(column_ids[entry.first])) {
+			case CellsColumn::ROW_KEY:
+				ranges = RestrictRanges(ranges, bounds);
+				break;
+			case CellsColumn::FAMILY:
+				family_bounds = bounds;
+				if (bounds.IsEquality()) {
+					filters.emplace_back(cbt::Filter::FamilyRegex(EscapeRegex(StringValue::Get(bounds.lower))));
+				}
+				break;
+			case CellsColumn::QUALIFIER:
+				qualifier_bounds = bounds;
+				break;
+			case CellsColumn::TIMESTAMP: {
+				int64_t start = 0;
+				int64_t end = 0;
+				if (!bounds.lower.IsNull()) {
+					start = MaxValue<int64_t>(GetMicros(bounds.lower) + (bounds.lower_inclusive ? 0 : 1), 0);
+					start = start / 1000 * 1000;
+				}
+				if (!bounds.upper.IsNull()) {
+					end = MaxValue<int64_t>(GetMicros(bounds.upper) + (bounds.upper_inclusive ? 1 : 0), 0);
+					end = (end + 999) / 1000 * 1000;
+				}
+				if (start > 0 || end > 0) {
+					filters.emplace_back(cbt::Filter::TimestampRangeMicros(start, end));
+				}
+				break;
+			}
+			case CellsColumn::VALUE:
+				if (!bounds.lower.IsNull() && !bounds.upper.IsNull()) {
+					const auto lower = StringValue::Get(bounds.lower);
+					const auto upper = StringValue::Get(bounds.upper);
+					if (bounds.lower_inclusive) {
+						filters.emplace_back(bounds.upper_inclusive ? cbt::Filter::ValueRangeClosed(lower, upper)
+						                                            : cbt::Filter::ValueRangeRightOpen(lower, upper));
+					} else {
+						filters.emplace_back(bounds.upper_inclusive ? cbt::Filter::ValueRangeLeftOpen(lower, upper)
+						                                            : cbt::Filter::ValueRangeOpen(lower, upper));
+					}
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (qualifier_bounds.IsEquality()) {
+			filters.emplace_back(cbt::Filter::ColumnRegex(EscapeRegex(StringValue::Get(qualifier_bounds.lower))));
+		} else if (family_bounds.IsEquality() && !qualifier_bounds.lower.IsNull() &&
+		           !qualifier_bounds.upper.IsNull()) {
+			// Qualifier ranges are only expressible within a single family
+			const auto family = StringValue::Get(family_bounds.lower);
+			const auto lower = StringValue::Get(qualifier_bounds.lower);
+			const auto upper = StringValue::Get(qualifier_bounds.upper);
+			if (qualifier_bounds.lower_inclusive) {
+				filters.emplace_back(qualifier_bounds.upper_inclusive
+				                         ? cbt::Filter::ColumnRangeClosed(family, lower, upper)
+				                         : cbt::Filter::ColumnRangeRightOpen(family, lower, upper));
+			} else {
+				filters.emplace_back(qualifier_bounds.upper_inclusive
+				                         ? cbt::Filter::ColumnRangeLeftOpen(family, lower, upper)
+				                         : cbt::Filter::ColumnRangeOpen(family, lower, upper));
+			}
+		}
+	}
+
+	if (std::find(column_ids.begin(), column_ids.end(), CellsColumn::VALUE) == column_ids.end()) {
+		filters.emplace_back(cbt::Filter::StripValueTransformer());
+	}
+
+	if (filters.empty()) {
+		return cbt::Filter::PassAllFilter();
+	}
+	if (filters.size() == 1) {
+		return std::move(filters[0]);
+	}
+	return cbt::Filter::ChainFromRange(filters.begin(), filters.end());
+}
+
+struct CellsGlobalState : GlobalTableFunctionState {
+	const cbt::Filter filter;
+	RangeReader reader;
+
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
+	const vector<column_t> column_ids;
+	const unique_ptr<Expression> filter_expression;
+	ScanProfiles profiles;
+
+	CellsGlobalState(const BigtableConfig &config, cbt::Filter filter_p, vector<cbt::RowRange> ranges_p,
+	                 vector<column_t> column_ids_p, unique_ptr<Expression> filter_expression_p)
+	    : filter(std::move(filter_p)), reader(config), scheduler(std::move(ranges_p)),
+	      max_inflight(config.max_inflight), column_ids(std::move(column_ids_p)),
+	      filter_expression(std::move(filter_expression_p)), profiles(config) {};
+
+	idx_t MaxThreads() const override {
+		return MinValue(scheduler.MaxThreads(), max_inflight);
+	}
+};
+
+unique_ptr<GlobalTableFunctionState> CellsInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<CellsFunctionData>();
+	vector<cbt::RowRange> ranges;
+	auto filter = MakeCellsFilter(input.filters, input.column_ids, bind_data.ranges, ranges);
+	auto filter_expression = MakeFilterExpression(input.filters, input.column_ids, CellsTypes());
+	return make_uniq<CellsGlobalState>(bind_data.config, std::move(filter), std::move(ranges), input.column_ids,
+	                                   std::move(filter_expression));
+}
+
+// A cell read but not yet emitted. Only the projected strings are copied out of the row.
+struct BufferedCell {
+	idx_t row_idx;
+	string family;
+	string qualifier;
+	int64_t timestamp;
+	string value;
+};
+
+struct CellsLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	bool keep_family = false;
+	bool keep_qualifier = false;
+	bool keep_value = false;
+	// Row keys and cells of the ranges read but not yet emitted
+	vector<string> row_keys;
+	vector<BufferedCell> cells;
+	idx_t cell_idx = 0;
+
+	unique_ptr<ExpressionExecutor> executor;
+	SelectionVector sel {STANDARD_VECTOR_SIZE};
+
+	explicit CellsLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> CellsInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                   GlobalTableFunctionState *global_state) {
+	auto &gstate = global_state->Cast<CellsGlobalState>();
+	auto local_state = make_uniq<CellsLocalState>(gstate.profiles.Register());
+	for (const auto column_id : gstate.column_ids) {
+		local_state->keep_family |= column_id == CellsColumn::FAMILY;
+		local_state->keep_qualifier |= column_id == CellsColumn::QUALIFIER;
+		local_state->keep_value |= column_id == CellsColumn::VALUE;
+	}
+	if (gstate.filter_expression) {
+		local_state->executor = make_uniq<ExpressionExecutor>(context.client, *gstate.filter_expression);
+	}
+	return local_state;
+}
+
+// Reads the next ranges through the RangeReader until a vector of cells is buffered or the ranges run out.
+static void ReadCells(CellsGlobalState &global_state, CellsLocalState &local_state) {
+	if (local_state.cell_idx == local_state.cells.size()) {
+		local_state.row_keys.clear();
+		local_state.cells.clear();
+		local_state.cell_idx = 0;
+	}
+
+	while (local_state.cells.size() - local_state.cell_idx < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			return;
+		}
+
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			const auto row_idx = local_state.row_keys.size();
+			local_state.row_keys.emplace_back(row.row_key());
+			for (const auto &cell : row.cells()) {
+				local_state.cells.push_back(BufferedCell {
+				    row_idx, local_state.keep_family ? cell.family_name() : string(),
+				    local_state.keep_qualifier ? cell.column_qualifier() : string(), cell.timestamp().count(),
+				    local_state.keep_value ? cell.value() : string()});
+			}
+		});
+	}
+}
+
+void CellsFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<CellsGlobalState>();
+	auto &local_state = data.local_state->Cast<CellsLocalState>();
+
+	while (true) {
+		ReadCells(global_state, local_state);
+		const idx_t count = MinValue<idx_t>(STANDARD_VECTOR_SIZE, local_state.cells.size() - local_state.cell_idx);
+
+		{
+			ProfileTimer emit_timer(local_state.profile.emit_ns);
+			for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+				auto &out_vec = output.data[col_idx];
+				const auto column_id = global_state.column_ids[col_idx];
+
+				for (idx_t i = 0; i < count; i++) {
+					const auto &cell = local_state.cells[local_state.cell_idx + i];
+					switch (column_id) {
+					case CellsColumn::ROW_KEY:
+						FlatVector::GetData<string_t>(out_vec)[i] =
+						    StringVector::AddString(out_vec, local_state.row_keys[cell.row_idx]);
+						break;
+					case CellsColumn::FAMILY:
+						FlatVector::GetData<string_t>(out_vec)[i] = StringVector::AddString(out_vec, cell.family);
+						break;
+					case CellsColumn::QUALIFIER:
+						FlatVector::GetData<string_t>(out_vec)[i] = StringVector::AddString(out_vec, cell.qualifier);
+						break;
+					case CellsColumn::TIMESTAMP:
+						FlatVector::GetData<timestamp_t>(out_vec)[i] = Timestamp::FromEpochMicroSeconds(cell.timestamp);
+						break;
+					case CellsColumn::VALUE:
+						FlatVector::GetData<string_t>(out_vec)[i] = StringVector::AddStringOrBlob(out_vec, cell.value);
+						break;
+					default:
+						break;
+					}
+				}
+			}
+		}
+		local_state.cell_idx += count;
+
+		output.SetCardinality(count);
+		if (count == 0 || !local_state.executor) {
+			return;
+		}
+		ApplyFilterExpression(*local_state.executor, local_state.sel, output);
+		ScanProfile::Add(local_state.profile.filtered, count - output.size());
+		if (output.size() > 0) {
+			return;
+		}
+		output.Reset();
+	}
+}
+
+double CellsScanProgress(ClientContext &context, const FunctionData *bind_data,
+                         const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<CellsGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> CellsDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<CellsGlobalState>().profiles.ToMap();
+}
+
+} // namespace duckdb
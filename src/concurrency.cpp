@@ -0,0 +1,74 @@
+#include "concurrency.hpp"
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+// Lowest limit a decrease can reach, and the share of the maximum a new limiter starts at
+static constexpr double MIN_LIMIT = 1.0;
+static constexpr double INITIAL_SHARE = 0.25;
+// First-byte latency above this multiple of the baseline is taken as queueing on the server
+static constexpr double LATENCY_TOLERANCE = 3.0;
+// Decreases are spaced by at least this long so that one burst of errors halves the limit once
+static constexpr auto DECREASE_COOLDOWN = std::chrono::milliseconds(100);
+
+ConcurrencyLimiter::ConcurrencyLimiter(idx_t max_limit_p)
+    : max_limit(static_cast<double>(max_limit_p)),
+      limit(MaxValue(MIN_LIMIT, static_cast<double>(max_limit_p) * INITIAL_SHARE)) {
+}
+
+ConcurrencyLimiter &ConcurrencyLimiter::Get(const BigtableConfig &config) {
+	static mutex lock;
+	static unordered_map<string, unique_ptr<ConcurrencyLimiter>> limiters;
+
+	const auto key = config.emulator_host + "/" + config.replay_path + "/" + config.project + "/" + config.instance +
+	                 "/" + std::to_string(config.max_inflight);
+	lock_guard<mutex> guard(lock);
+	auto &limiter = limiters[key];
+	if (!limiter) {
+		limiter = make_uniq<ConcurrencyLimiter>(config.max_inflight);
+	}
+	return *limiter;
+}
+
+void ConcurrencyLimiter::Acquire() {
+	std::unique_lock<mutex> guard(lock);
+	available.wait(guard, [&] { return static_cast<double>(inflight) < limit; });
+	inflight++;
+}
+
+void ConcurrencyLimiter::Decrease(double factor) {
+	const auto now = std::chrono::steady_clock::now();
+	if (now - last_decrease < DECREASE_COOLDOWN) {
+		return;
+	}
+	last_decrease = now;
+	limit = MaxValue(MIN_LIMIT, limit * factor);
+}
+
+void ConcurrencyLimiter::Release(std::optional<duration> first_byte_latency, bool overloaded) {
+	{
+		lock_guard<mutex> guard(lock);
+		inflight--;
+		if (overloaded) {
+			Decrease(0.5);
+		} else if (first_byte_latency) {
+			// The baseline follows the lowest latency, drifting up slowly so it can recover from an outlier
+			const auto latency = *first_byte_latency;
+			baseline_latency = baseline_latency ? MinValue(latency, *baseline_latency + *baseline_latency / 100) : latency;
+			if (latency > *baseline_latency * LATENCY_TOLERANCE) {
+				Decrease(0.9);
+			} else {
+				limit = MinValue(max_limit, limit + 1.0 / limit);
+			}
+		}
+	}
+	available.notify_all();
+}
+
+double ConcurrencyLimiter::Limit() const {
+	lock_guard<mutex> guard(lock);
+	return limit;
+}
+
+} // namespace duckdb
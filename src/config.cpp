@@ -0,0 +1,248 @@
+#include "config.hpp"
+
+#include "duckdb.hpp"
+#include "duckdb/catalog/catalog_transaction.hpp"
+#include "duckdb/main/config.hpp"
+#include "duckdb/main/extension/extension_loader.hpp"
+#include "duckdb/main/secret/secret.hpp"
+#include "duckdb/main/secret/secret_manager.hpp"
+#include "metrics.hpp"
+#include "replay.hpp"
+
+#include <google/cloud/backoff_policy.h>
+#include <google/cloud/bigtable/options.h>
+#include <google/cloud/bigtable/table.h>
+#include <google/cloud/common_options.h>
+#include <google/cloud/credentials.h>
+#include <google/cloud/grpc_options.h>
+
+using ::google::cloud::EndpointOption;
+using ::google::cloud::ExponentialBackoffPolicy;
+using ::google::cloud::GrpcNumChannelsOption;
+using ::google::cloud::MakeInsecureCredentials;
+using ::google::cloud::Options;
+using ::google::cloud::UnifiedCredentialsOption;
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+static const char *const SECRET_KEYS[] = {"project", "instance", "app_profile", "emulator_host"};
+
+static void ReadSetting(ClientContext &context, const char *name, string &target) {
+	Value value;
+	if (context.TryGetCurrentSetting(name, value) && !value.IsNull()) {
+		target = value.ToString();
+	}
+}
+
+static void ReadSetting(ClientContext &context, const char *name, idx_t &target) {
+	Value value;
+	if (context.TryGetCurrentSetting(name, value) && !value.IsNull()) {
+		target = UBigIntValue::Get(value);
+	}
+}
+
+static void ReadSetting(ClientContext &context, const char *name, double &target) {
+	Value value;
+	if (context.TryGetCurrentSetting(name, value) && !value.IsNull()) {
+		target = DoubleValue::Get(value);
+	}
+}
+
+static void ReadSetting(ClientContext &context, const char *name, bool &target) {
+	Value value;
+	if (context.TryGetCurrentSetting(name, value) && !value.IsNull()) {
+		target = BooleanValue::Get(value);
+	}
+}
+
+BigtableConfig BigtableConfig::Get(ClientContext &context, const string &table_id) {
+	BigtableConfig config;
+	config.table_id = table_id;
+	ReadSetting(context, "bigtable_project", config.project);
+	ReadSetting(context, "bigtable_instance", config.instance);
+	ReadSetting(context, "bigtable_app_profile", config.app_profile);
+	ReadSetting(context, "bigtable_emulator_host", config.emulator_host);
+	ReadSetting(context, "bigtable_channels", config.channels);
+	ReadSetting(context, "bigtable_max_inflight", config.max_inflight);
+	ReadSetting(context, "bigtable_timeout_ms", config.timeout_ms);
+	ReadSetting(context, "bigtable_retry_initial_backoff_ms", config.retry_initial_backoff_ms);
+	ReadSetting(context, "bigtable_retry_max_backoff_ms", config.retry_max_backoff_ms);
+	ReadSetting(context, "bigtable_record_path", config.record_path);
+	ReadSetting(context, "bigtable_replay_path", config.replay_path);
+	ReadSetting(context, "bigtable_replay_latency_ms", config.replay_latency_ms);
+	ReadSetting(context, "bigtable_hedge_quantile", config.hedge_quantile);
+	ReadSetting(context, "bigtable_hedge_budget", config.hedge_budget);
+	ReadSetting(context, "bigtable_sample_ranges", config.sample_ranges);
+	ReadSetting(context, "bigtable_estimate_path", config.estimate_path);
+	if (!config.estimate_path.empty()) {
+		// Estimates are written when a scan completes, where a failure can no longer be reported, so a path in a
+		// missing directory is rejected up front
+		auto &fs = FileSystem::GetFileSystem(context);
+		config.estimate_path = fs.ExpandPath(config.estimate_path);
+		const auto separator = config.estimate_path.find_last_of("/\\");
+		if (separator != string::npos && separator > 0) {
+			const auto directory = config.estimate_path.substr(0, separator);
+			if (!fs.DirectoryExists(directory)) {
+				throw InvalidInputException("bigtable_estimate_path: directory \"%s\" does not exist", directory);
+			}
+		}
+	}
+
+	auto &secret_manager = SecretManager::Get(context);
+	auto transaction = CatalogTransaction::GetSystemCatalogTransaction(context);
+	auto secret_match = secret_manager.LookupSecret(transaction, "bigtable://" + table_id, "bigtable");
+	if (secret_match.HasMatch()) {
+		const auto &secret = dynamic_cast<const KeyValueSecret &>(secret_match.GetSecret());
+		string *targets[] = {&config.project, &config.instance, &config.app_profile, &config.emulator_host};
+		for (idx_t i = 0; i < 4; i++) {
+			const auto value = secret.TryGetValue(SECRET_KEYS[i]);
+			if (!value.IsNull()) {
+				*targets[i] = value.ToString();
+			}
+		}
+	}
+
+	if (config.channels == 0 || config.max_inflight == 0) {
+		throw InvalidInputException("bigtable_channels and bigtable_max_inflight must be positive");
+	}
+	if (config.hedge_quantile < 0 || config.hedge_quantile >= 1 || config.hedge_budget < 0) {
+		throw InvalidInputException("bigtable_hedge_quantile must be in [0, 1) and bigtable_hedge_budget non-negative");
+	}
+	return config;
+}
+
+string BigtableConfig::GetTableId(ClientContext &context, const string &preset) {
+	string table_id = preset;
+	Value value;
+	if (context.TryGetCurrentSetting("bigtable_" + preset + "_table", value) && !value.IsNull()) {
+		table_id = value.ToString();
+	}
+	return table_id;
+}
+
+static std::shared_ptr<cbt::DataConnection> GetConnection(const BigtableConfig &config) {
+	static mutex lock;
+	static unordered_map<string, std::shared_ptr<cbt::DataConnection>> connections;
+
+	lock_guard<mutex> guard(lock);
+	if (!config.replay_path.empty()) {
+		auto &connection = connections["replay:" + config.replay_path + "/" + std::to_string(config.replay_latency_ms)];
+		if (!connection) {
+			connection = MakeReplayConnection(config.replay_path, config.replay_latency_ms);
+		}
+		return connection;
+	}
+
+	const auto key = config.emulator_host + "/" + std::to_string(config.channels);
+	auto &connection = connections[key];
+	if (!connection) {
+		auto options = Options {}.set<GrpcNumChannelsOption>(static_cast<int>(config.channels));
+		if (!config.emulator_host.empty()) {
+			options.set<EndpointOption>(config.emulator_host);
+			options.set<UnifiedCredentialsOption>(MakeInsecureCredentials());
+		}
+		connection = cbt::MakeDataConnection(std::move(options));
+		BigtableMetrics::Get().channels.fetch_add(config.channels, std::memory_order_relaxed);
+	}
+	if (config.record_path.empty()) {
+		return connection;
+	}
+
+	// A recording connection wraps the connection of its endpoint, the recorders of one path append to one shared file
+	auto &recording = connections["record:" + config.record_path + "/" + key];
+	if (!recording) {
+		recording = MakeRecordingConnection(connection, config.record_path);
+	}
+	return recording;
+}
+
+std::unique_ptr<cbt::DataRetryPolicy> BigtableConfig::MakeRetryPolicy() const {
+	return cbt::DataLimitedTimeRetryPolicy(std::chrono::milliseconds(timeout_ms)).clone();
+}
+
+cbt::Table BigtableConfig::MakeTable() const {
+	auto options =
+	    Options {}
+	        .set<cbt::DataRetryPolicyOption>(MakeRetryPolicy())
+	        .set<cbt::DataBackoffPolicyOption>(
+	            ExponentialBackoffPolicy(std::chrono::milliseconds(retry_initial_backoff_ms),
+	                                     std::chrono::milliseconds(retry_max_backoff_ms), 2.0)
+	                .clone());
+	if (!app_profile.empty()) {
+		options.set<cbt::AppProfileIdOption>(app_profile);
+	}
+	return cbt::Table(GetConnection(*this), cbt::TableResource(project, instance, table_id), std::move(options));
+}
+
+static unique_ptr<BaseSecret> CreateBigtableSecret(ClientContext &context, CreateSecretInput &input) {
+	auto scope = input.scope;
+	if (scope.empty()) {
+		scope.emplace_back("bigtable://");
+	}
+	auto secret = make_uniq<KeyValueSecret>(scope, input.type, input.provider, input.name);
+	for (const auto &option : input.options) {
+		secret->secret_map[StringUtil::Lower(option.first)] = option.second.ToString();
+	}
+	return std::move(secret);
+}
+
+void RegisterBigtableConfig(ExtensionLoader &loader) {
+	auto &config = DBConfig::GetConfig(loader.GetDatabaseInstance());
+	config.AddExtensionOption("bigtable_project", "Google Cloud project of the Bigtable instance",
+	                          LogicalType::VARCHAR, Value("dataimpact-processing"));
+	config.AddExtensionOption("bigtable_instance", "Bigtable instance to read from and write to", LogicalType::VARCHAR,
+	                          Value("processing"));
+	config.AddExtensionOption("bigtable_app_profile", "Bigtable app profile, empty for the instance default",
+	                          LogicalType::VARCHAR, Value(""));
+	config.AddExtensionOption("bigtable_emulator_host",
+	                          "host:port of a Bigtable emulator, empty to connect to Google Cloud", LogicalType::VARCHAR,
+	                          Value(""));
+	config.AddExtensionOption("bigtable_product_table", "Table read by the product functions", LogicalType::VARCHAR,
+	                          Value("product"));
+	config.AddExtensionOption("bigtable_search_table", "Table read by the search functions", LogicalType::VARCHAR,
+	                          Value("search"));
+	config.AddExtensionOption("bigtable_channels", "Number of gRPC channels of each Bigtable connection",
+	                          LogicalType::UBIGINT, Value::UBIGINT(32));
+	config.AddExtensionOption("bigtable_max_inflight",
+	                          "Ceiling of the adaptive limit on ReadRows streams open at once per instance",
+	                          LogicalType::UBIGINT, Value::UBIGINT(64));
+	config.AddExtensionOption("bigtable_timeout_ms", "Time budget of a Bigtable call including its retries",
+	                          LogicalType::UBIGINT, Value::UBIGINT(600000));
+	config.AddExtensionOption("bigtable_retry_initial_backoff_ms", "Initial backoff between Bigtable retries",
+	                          LogicalType::UBIGINT, Value::UBIGINT(100));
+	config.AddExtensionOption("bigtable_retry_max_backoff_ms", "Maximum backoff between Bigtable retries",
+	                          LogicalType::UBIGINT, Value::UBIGINT(60000));
+	config.AddExtensionOption("bigtable_record_path", "File to append every ReadRows response to, empty to disable",
+	                          LogicalType::VARCHAR, Value(""));
+	config.AddExtensionOption("bigtable_replay_path",
+	                          "File of recorded ReadRows responses to serve instead of Bigtable, empty to disable",
+	                          LogicalType::VARCHAR, Value(""));
+	config.AddExtensionOption("bigtable_replay_latency_ms", "Delay added before each replayed ReadRows stream",
+	                          LogicalType::UBIGINT, Value::UBIGINT(0));
+	config.AddExtensionOption("bigtable_hedge_quantile",
+	                          "Latency quantile of point reads after which a duplicate is sent, 0 to disable",
+	                          LogicalType::DOUBLE, Value::DOUBLE(0));
+	config.AddExtensionOption("bigtable_hedge_budget", "Maximum share of point reads that may be duplicated",
+	                          LogicalType::DOUBLE, Value::DOUBLE(0.05));
+	config.AddExtensionOption("bigtable_sample_ranges",
+	                          "Sample TABLESAMPLE percentages by skipping whole row ranges instead of by row",
+	                          LogicalType::BOOLEAN, Value::BOOLEAN(false));
+	config.AddExtensionOption("bigtable_estimate_path",
+	                          "File keeping the row estimates learned by product and search scans, empty to disable",
+	                          LogicalType::VARCHAR, Value(""));
+
+	SecretType secret_type;
+	secret_type.name = "bigtable";
+	secret_type.deserializer = KeyValueSecret::Deserialize<KeyValueSecret>;
+	secret_type.default_provider = "config";
+	loader.RegisterSecretType(secret_type);
+
+	CreateSecretFunction secret_function = {"bigtable", "config", CreateBigtableSecret};
+	for (const auto key : SECRET_KEYS) {
+		secret_function.named_parameters[key] = LogicalType::VARCHAR;
+	}
+	loader.RegisterFunction(secret_function);
+}
+
+} // namespace duckdb
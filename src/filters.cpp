@@ -0,0 +1,118 @@
+#include "filters.hpp"
+
+#include "duckdb.hpp"
+#include "duckdb/planner/expression/bound_conjunction_expression.hpp"
+#include "duckdb/planner/expression/bound_reference_expression.hpp"
+#include "duckdb/planner/filter/conjunction_filter.hpp"
+#include "duckdb/planner/filter/constant_filter.hpp"
+#include "duckdb/planner/filter/optional_filter.hpp"
+
+namespace duckdb {
+
+static void AddLower(FilterBounds &bounds, const Value &value, bool inclusive) {
+	if (bounds.lower.IsNull() || value > bounds.lower || (value == bounds.lower && !inclusive)) {
+		bounds.lower = value;
+		bounds.lower_inclusive = inclusive;
+	}
+}
+
+static void AddUpper(FilterBounds &bounds, const Value &value, bool inclusive) {
+	if (bounds.upper.IsNull() || value < bounds.upper || (value == bounds.upper && !inclusive)) {
+		bounds.upper = value;
+		bounds.upper_inclusive = inclusive;
+	}
+}
+
+static void CollectBounds(const TableFilter &filter, FilterBounds &bounds) {
+	switch (filter.filter_type) {
+	case TableFilterType::CONSTANT_COMPARISON: {
+		const auto &constant_filter = filter.Cast<ConstantFilter>();
+		const auto &constant = constant_filter.constant;
+		switch (constant_filter.comparison_type) {
+		case ExpressionType::COMPARE_EQUAL:
+			AddLower(bounds, constant, true);
+			AddUpper(bounds, constant, true);
+			break;
+		case ExpressionType::COMPARE_GREATERTHAN:
+			AddLower(bounds, constant, false);
+			break;
+		case ExpressionType::COMPARE_GREATERTHANOREQUALTO:
+			AddLower(bounds, constant, true);
+			break;
+		case ExpressionType::COMPARE_LESSTHAN:
+			AddUpper(bounds, constant, false);
+			break;
+		case ExpressionType::COMPARE_LESSTHANOREQUALTO:
+			AddUpper(bounds, constant, true);
+			break;
+		default:
+			break;
+		}
+		break;
+	}
+	case TableFilterType::CONJUNCTION_AND:
+		for (const auto &child : filter.Cast<ConjunctionAndFilter>().child_filters) {
+			CollectBounds(*child, bounds);
+		}
+		break;
+	case TableFilterType::OPTIONAL_FILTER: {
+		const auto &child = filter.Cast<OptionalFilter>().child_filter;
+		if (child) {
+			CollectBounds(*child, bounds);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+FilterBounds GetFilterBounds(const TableFilter &filter) {
+	FilterBounds bounds;
+	CollectBounds(filter, bounds);
+	return bounds;
+}
+
+string EscapeRegex(const string &literal) {
+	string result;
+	result.reserve(literal.size());
+	for (const auto c : literal) {
+		if (c != '\0' && strchr("\\.^$|?*+()[]{}", c)) {
+			result += '\\';
+		}
+		result += c;
+	}
+	return result;
+}
+
+unique_ptr<Expression> MakeFilterExpression(optional_ptr<TableFilterSet> filters, const vector<column_t> &column_ids,
+                                            const vector<LogicalType> &types) {
+	if (!filters) {
+		return nullptr;
+	}
+
+	unique_ptr<Expression> result;
+	for (const auto &entry : filters->filters) {
+		const auto column_id = column_ids[entry.first];
+		BoundReferenceExpression column(types[column_id], entry.first);
+		auto expression = entry.second->ToExpression(column);
+		if (!result) {
+			result = std::move(expression);
+		} else {
+			result = make_uniq<BoundConjunctionExpression>(ExpressionType::CONJUNCTION_AND, std::move(result),
+			                                               std::move(expression));
+		}
+	}
+	return result;
+}
+
+idx_t ApplyFilterExpression(ExpressionExecutor &executor, SelectionVector &sel, DataChunk &chunk) {
+	const idx_t input_count = chunk.size();
+	const idx_t count = executor.SelectExpression(chunk, sel);
+	if (count != input_count) {
+		chunk.Slice(sel, count);
+	}
+	return input_count - count;
+}
+
+} // namespace duckdb
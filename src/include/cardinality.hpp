@@ -0,0 +1,32 @@
+#pragma once
+
+#include "config.hpp"
+#include "duckdb.hpp"
+
+#include <optional>
+
+namespace duckdb {
+
+// Rows a scan emits per range and week of a table, learned from the scans that read every range to the end and
+// shared by every later scan of the table, so that the optimizer can size the scan before any of its rows are read.
+// When `bigtable_estimate_path` is set, estimates are also kept in that file so that they outlive the session.
+class RowEstimate {
+public:
+	RowEstimate(string path_p, string key_p) : path(std::move(path_p)), key(std::move(key_p)) {};
+
+	// The estimate of a table and kind of range, such as point ranges of one shop or spans of every shop
+	static RowEstimate &Get(const BigtableConfig &config, const string &kind);
+
+	// Rows per range and week, unknown until a scan has completed
+	std::optional<double> RowsPerRangeWeek() const;
+	// Folds in the rows of a completed scan over `range_weeks` ranges times weeks
+	void Learn(idx_t range_weeks, idx_t rows);
+
+private:
+	const string path;
+	const string key;
+	mutable mutex lock;
+	std::optional<double> rows_per_range_week;
+};
+
+} // namespace duckdb
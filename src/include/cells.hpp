@@ -0,0 +1,25 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+unique_ptr<FunctionData> CellsFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                           vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> CellsInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> CellsInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                   GlobalTableFunctionState *global_state);
+
+void CellsFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+double CellsScanProgress(ClientContext &context, const FunctionData *bind_data,
+                         const GlobalTableFunctionState *global_state);
+
+InsertionOrderPreservingMap<string> CellsDynamicToString(TableFunctionDynamicToStringInput &input);
+
+} // namespace duckdb
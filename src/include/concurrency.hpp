@@ -0,0 +1,57 @@
+#pragma once
+
+#include "config.hpp"
+#include "duckdb.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <optional>
+
+namespace duckdb {
+
+// AIMD limit on the ReadRows streams open at once against one Bigtable instance, shared by every scan.
+// The limit grows by one stream per round of successful streams, and shrinks by half on throttling errors
+// and by a tenth when first-byte latency climbs well above the lowest latency observed.
+class ConcurrencyLimiter {
+public:
+	using duration = std::chrono::steady_clock::duration;
+
+	explicit ConcurrencyLimiter(idx_t max_limit);
+
+	// The limiter of the instance and stream budget of a configuration
+	static ConcurrencyLimiter &Get(const BigtableConfig &config);
+
+	// Blocks until a stream may be opened
+	void Acquire();
+	// Returns the slot of a finished stream, with its first-byte latency when it succeeded
+	void Release(std::optional<duration> first_byte_latency, bool overloaded);
+
+	double Limit() const;
+
+	// Holds a stream slot from construction to destruction, reporting the outcome of the stream on release
+	struct Slot {
+		ConcurrencyLimiter &limiter;
+		std::optional<duration> first_byte_latency;
+		bool overloaded = false;
+
+		explicit Slot(ConcurrencyLimiter &limiter_p) : limiter(limiter_p) {
+			limiter.Acquire();
+		}
+		~Slot() {
+			limiter.Release(first_byte_latency, overloaded);
+		}
+	};
+
+private:
+	mutable mutex lock;
+	std::condition_variable available;
+	const double max_limit;
+	double limit;
+	idx_t inflight = 0;
+	std::optional<duration> baseline_latency;
+	std::chrono::steady_clock::time_point last_decrease;
+
+	void Decrease(double factor);
+};
+
+} // namespace duckdb
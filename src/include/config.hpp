@@ -0,0 +1,55 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+class ExtensionLoader;
+
+// Where and how to reach a Bigtable table, resolved at bind time from the `bigtable_*` settings,
+// overridden by a `bigtable` secret whose scope matches `bigtable://<table>`.
+struct BigtableConfig {
+	string project = "dataimpact-processing";
+	string instance = "processing";
+	string table_id;
+	string app_profile;
+	// host:port of a Bigtable emulator, connected to without credentials
+	string emulator_host;
+	idx_t channels = 32;
+	// Ceiling of the adaptive limit on ReadRows streams open at once against the instance
+	idx_t max_inflight = 64;
+	idx_t timeout_ms = 600000;
+	idx_t retry_initial_backoff_ms = 100;
+	idx_t retry_max_backoff_ms = 60000;
+	// File receiving every ReadRows response, empty to disable recording
+	string record_path;
+	// File serving ReadRows responses instead of Bigtable, empty to read from Bigtable
+	string replay_path;
+	// Delay added before each replayed stream
+	idx_t replay_latency_ms = 0;
+	// Latency quantile after which a point read is duplicated, 0 to disable hedging
+	double hedge_quantile = 0;
+	// Maximum share of point reads that may be duplicated
+	double hedge_budget = 0.05;
+	// Whether a TABLESAMPLE skips whole row ranges rather than sampling rows server-side
+	bool sample_ranges = false;
+	// File keeping the learned row estimates across sessions, empty to keep them in memory only
+	string estimate_path;
+
+	static BigtableConfig Get(ClientContext &context, const string &table_id);
+
+	// Returns the table name configured for a preset scan, e.g. `bigtable_product_table` for "product"
+	static string GetTableId(ClientContext &context, const string &preset);
+
+	std::unique_ptr<cbt::DataRetryPolicy> MakeRetryPolicy() const;
+
+	// Opens the table, sharing the data connection of every configuration with the same endpoint and channels
+	cbt::Table MakeTable() const;
+};
+
+void RegisterBigtableConfig(ExtensionLoader &loader);
+
+} // namespace duckdb
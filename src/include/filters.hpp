@@ -0,0 +1,37 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "duckdb/execution/expression_executor.hpp"
+#include "duckdb/planner/table_filter.hpp"
+
+namespace duckdb {
+
+// Bounds on a column implied by the constant comparisons of a filter pushed into a scan.
+// A NULL bound means the column is unbounded on that side.
+struct FilterBounds {
+	Value lower;
+	bool lower_inclusive = true;
+	Value upper;
+	bool upper_inclusive = true;
+
+	bool IsEquality() const {
+		return !lower.IsNull() && !upper.IsNull() && lower_inclusive && upper_inclusive && lower == upper;
+	}
+};
+
+// Collects the bounds of the constant comparisons of a filter, ignoring the filters it cannot express as bounds.
+FilterBounds GetFilterBounds(const TableFilter &filter);
+
+// Escapes a literal so that it matches itself in a Bigtable RE2 regex.
+string EscapeRegex(const string &literal);
+
+// Builds a boolean expression of the filters pushed into a scan, over the columns of its output chunks.
+// DuckDB drops pushed filters from the plan, so the scan evaluates them on its output even when they
+// were also translated into a Bigtable filter. Returns nullptr when there are no filters.
+unique_ptr<Expression> MakeFilterExpression(optional_ptr<TableFilterSet> filters, const vector<column_t> &column_ids,
+                                            const vector<LogicalType> &types);
+
+// Removes the rows of a chunk that do not pass the filter expression, returns the number of rows removed.
+idx_t ApplyFilterExpression(ExpressionExecutor &executor, SelectionVector &sel, DataChunk &chunk);
+
+} // namespace duckdb
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+// Row keys of the product and search tables are laid out as `<reversed id>/<week>/<shop_id>`,
+// where week is the ISO year and week number written as YYYYWW (e.g. 202420).
+
+// Reverses the decimal representation of an id so that sequential ids spread across tablets.
+string ReverseId(uint64_t id);
+
+// Returns the YYYYWW week of a date.
+int32_t WeekKey(date_t date);
+
+// Returns the Monday of a YYYYWW week.
+date_t WeekStart(int32_t week);
+
+// Returns the number of weeks from the week of `week_start` to the week of `week_end`, both included.
+idx_t WeekCount(int32_t week_start, int32_t week_end);
+
+// Builds the row key of an id, a week and a shop.
+string MakeRowKey(uint64_t id, int32_t week, uint32_t shop_id);
+
+} // namespace duckdb
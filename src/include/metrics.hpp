@@ -0,0 +1,113 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+#include <chrono>
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// Lock-free log-linear histogram: exact below 16, then 16 sub-buckets per power of two (~6% relative error).
+class LatencyHistogram {
+public:
+	static constexpr idx_t SUB_BUCKET_BITS = 4;
+	static constexpr idx_t SUB_BUCKETS = idx_t(1) << SUB_BUCKET_BITS;
+	static constexpr idx_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+	void Record(uint64_t value);
+	void Reset();
+
+	uint64_t Count() const;
+	uint64_t Max() const;
+	// Upper bound of the bucket holding the given quantile, 0 when empty
+	uint64_t Quantile(double quantile) const;
+
+private:
+	static idx_t BucketIndex(uint64_t value);
+	static uint64_t BucketUpperBound(idx_t index);
+
+	std::array<atomic<uint64_t>, BUCKETS> counts {};
+	atomic<uint64_t> max {0};
+};
+
+// Process-wide ReadRows metrics, aggregated since the extension was loaded or last reset.
+struct BigtableMetrics {
+	// gRPC status codes go from OK (0) to UNAUTHENTICATED (16)
+	static constexpr idx_t STATUS_CODES = 17;
+
+	LatencyHistogram first_byte_us;
+	LatencyHistogram completion_us;
+	// Latency of the first attempt of single-row reads, at least the race's when a hedge won, from which the hedging
+	// delay is learned
+	LatencyHistogram point_read_us;
+	// Latency of every single-row read up to its first successful response, hedged or not
+	LatencyHistogram point_race_us;
+	atomic<uint64_t> point_reads {0};
+	atomic<uint64_t> hedges {0};
+	atomic<uint64_t> streams {0};
+	atomic<uint64_t> rows {0};
+	atomic<uint64_t> bytes {0};
+	std::array<atomic<uint64_t>, STATUS_CODES> errors {};
+	atomic<int64_t> active_streams {0};
+	atomic<int64_t> peak_active_streams {0};
+	// gRPC channels of the data connections opened so far
+	atomic<uint64_t> channels {0};
+	atomic<int64_t> since_us;
+
+	BigtableMetrics();
+
+	static BigtableMetrics &Get();
+
+	void Reset();
+};
+
+// Records one ReadRows stream into BigtableMetrics. Rows and bytes are accumulated locally and published once
+// when the stream ends, so the shared counters are touched per stream rather than per row.
+class StreamMetrics {
+public:
+	StreamMetrics();
+	~StreamMetrics();
+
+	StreamMetrics(const StreamMetrics &) = delete;
+	StreamMetrics &operator=(const StreamMetrics &) = delete;
+
+	void OnRow(uint64_t row_bytes);
+	void OnError(const google::cloud::Status &status);
+
+private:
+	BigtableMetrics &metrics;
+	const std::chrono::steady_clock::time_point start;
+	bool first_byte = false;
+	bool failed = false;
+	uint64_t rows = 0;
+	uint64_t bytes = 0;
+
+	void RecordFirstByte();
+};
+
+// Approximates the payload of a row: its key plus the family, qualifier and value of every cell.
+inline uint64_t RowBytes(const cbt::Row &row) {
+	uint64_t bytes = row.row_key().size();
+	for (const auto &cell : row.cells()) {
+		bytes += cell.family_name().size() + cell.column_qualifier().size() + cell.value().size();
+	}
+	return bytes;
+}
+
+unique_ptr<FunctionData> MetricsFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                             vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> MetricsInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+void MetricsFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+unique_ptr<FunctionData> MetricsResetFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> MetricsResetInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+void MetricsResetFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+} // namespace duckdb
@@ -20,7 +20,25 @@ void ProductFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 double ProductScanProgress(ClientContext &context, const FunctionData *bind_data,
                            const GlobalTableFunctionState *global_state);
 
+InsertionOrderPreservingMap<string> ProductDynamicToString(TableFunctionDynamicToStringInput &input);
+
+unique_ptr<NodeStatistics> ProductCardinality(ClientContext &context, const FunctionData *bind_data);
+
 unique_ptr<BaseStatistics> ProductStatistics(ClientContext &context, const FunctionData *bind_data,
                                              column_t column_index);
 
+unique_ptr<FunctionData> ProductLookupFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> ProductLookupInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> ProductLookupInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                           GlobalTableFunctionState *global_state);
+
+OperatorResultType ProductLookupFunction(ExecutionContext &context, TableFunctionInput &data, DataChunk &input,
+                                         DataChunk &output);
+
+OperatorFinalizeResultType ProductLookupFunctionFinal(ExecutionContext &context, TableFunctionInput &data,
+                                                      DataChunk &output);
+
 } // namespace duckdb
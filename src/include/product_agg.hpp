@@ -0,0 +1,22 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+unique_ptr<FunctionData> ProductAggFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> ProductAggInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> ProductAggInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                        GlobalTableFunctionState *global_state);
+
+void ProductAggFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+double ProductAggScanProgress(ClientContext &context, const FunctionData *bind_data,
+                              const GlobalTableFunctionState *global_state);
+
+InsertionOrderPreservingMap<string> ProductAggDynamicToString(TableFunctionDynamicToStringInput &input);
+
+} // namespace duckdb
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+unique_ptr<FunctionData> ProductShelvesFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                    vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> ProductShelvesInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> ProductShelvesInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                            GlobalTableFunctionState *global_state);
+
+void ProductShelvesFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+double ProductShelvesScanProgress(ClientContext &context, const FunctionData *bind_data,
+                                  const GlobalTableFunctionState *global_state);
+
+InsertionOrderPreservingMap<string> ProductShelvesDynamicToString(TableFunctionDynamicToStringInput &input);
+
+} // namespace duckdb
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "duckdb/common/insertion_order_preserving_map.hpp"
+
+#include <chrono>
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// Counters of one scan thread. Only the owning thread writes them, so updates are plain relaxed stores;
+// other threads read them while rendering the profile.
+struct alignas(64) ScanProfile {
+	atomic<uint64_t> rpcs {0};
+	atomic<uint64_t> retries {0};
+	// Single-row reads, and the duplicates sent when one was slower than the hedging delay
+	atomic<uint64_t> point_reads {0};
+	atomic<uint64_t> hedges {0};
+	// Streams resumed after their last row following a transient error
+	atomic<uint64_t> resumes {0};
+	atomic<uint64_t> rows {0};
+	atomic<uint64_t> cells {0};
+	atomic<uint64_t> bytes {0};
+	// Rows and cells dropped by the client-side checks of the scan
+	atomic<uint64_t> filtered {0};
+	// Time blocked waiting for the concurrency limiter or backing off before a resume
+	atomic<uint64_t> throttle_ns {0};
+	// Time blocked waiting for the next row of a stream
+	atomic<uint64_t> stream_ns {0};
+	// Time turning rows into scan tuples
+	atomic<uint64_t> decode_ns {0};
+	// Time filling output vectors
+	atomic<uint64_t> emit_ns {0};
+
+	// Per-call options counting the retries of this thread's ReadRows streams
+	google::cloud::Options call_options;
+
+	static void Add(atomic<uint64_t> &counter, uint64_t value) {
+		counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+	}
+};
+
+// Adds the time spent in its scope to a ScanProfile timer.
+struct ProfileTimer {
+	atomic<uint64_t> &target;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	explicit ProfileTimer(atomic<uint64_t> &target_p) : target(target_p) {};
+
+	~ProfileTimer() {
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		ScanProfile::Add(target, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+	}
+};
+
+// The profiles of every thread of a scan, registered once per thread and summed when rendered.
+class ScanProfiles {
+public:
+	explicit ScanProfiles(const BigtableConfig &config) : config(config) {};
+
+	ScanProfile &Register();
+
+	// Renders the summed counters for EXPLAIN ANALYZE
+	InsertionOrderPreservingMap<string> ToMap() const;
+
+private:
+	const BigtableConfig config;
+	mutable mutex lock;
+	vector<unique_ptr<ScanProfile>> profiles;
+};
+
+} // namespace duckdb
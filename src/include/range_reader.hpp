@@ -0,0 +1,212 @@
+#pragma once
+
+#include "concurrency.hpp"
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "metrics.hpp"
+#include "profile.hpp"
+
+#include <chrono>
+#include <google/cloud/bigtable/table.h>
+#include <optional>
+#include <random>
+#include <thread>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// Reads the ranges of a scan under the instance's concurrency limit, resuming a stream after its last row
+// when it fails with an error the client library does not retry on its own.
+struct RangeReader {
+	cbt::Table table;
+	ConcurrencyLimiter &limiter;
+	const std::chrono::milliseconds timeout;
+	const std::chrono::milliseconds initial_backoff;
+	const std::chrono::milliseconds max_backoff;
+	const double hedge_quantile;
+	const double hedge_budget;
+
+	explicit RangeReader(const BigtableConfig &config)
+	    : table(config.MakeTable()), limiter(ConcurrencyLimiter::Get(config)),
+	      timeout(config.timeout_ms), initial_backoff(config.retry_initial_backoff_ms),
+	      max_backoff(config.retry_max_backoff_ms), hedge_quantile(config.hedge_quantile),
+	      hedge_budget(config.hedge_budget) {};
+
+	using PointResult = google::cloud::StatusOr<std::pair<bool, cbt::Row>>;
+
+	// Throttling and transport errors, which resuming after a backoff can get past
+	static bool IsTransient(const google::cloud::Status &status) {
+		using google::cloud::StatusCode;
+		switch (status.code()) {
+		case StatusCode::kResourceExhausted:
+		case StatusCode::kUnavailable:
+		case StatusCode::kDeadlineExceeded:
+		case StatusCode::kAborted:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// A range holding a single row key, which is read with a hedged single-row read when hedging is enabled
+	static bool IsPoint(const cbt::RowRange &range) {
+		const auto &proto = range.as_proto();
+		return proto.has_start_key_closed() && proto.has_end_key_closed() &&
+		       proto.start_key_closed() == proto.end_key_closed();
+	}
+
+	// Reads one row, sending a duplicate when the first attempt is slower than the learned hedging delay.
+	// The first successful response wins and the other attempt is cancelled.
+	PointResult ReadPoint(const std::string &row_key, const cbt::Filter &filter, ScanProfile &profile);
+
+	// Streams the rows of a range to `on_row`, accounting RPCs, rows, cells, bytes and wait/decode time.
+	template <class ROWS, class ON_ROW>
+	void Read(const ROWS &rows, const cbt::Filter &filter, ScanProfile &profile, ON_ROW &&on_row) {
+		using clock = std::chrono::steady_clock;
+		const auto deadline = clock::now() + timeout;
+		auto backoff = initial_backoff;
+		std::optional<std::string> last_key;
+		ROWS remaining = rows;
+		const auto point_key = hedge_quantile > 0 ? PointKey(rows) : std::nullopt;
+
+		while (true) {
+			const auto status = point_key ? ReadPointStream(*point_key, filter, profile, on_row)
+			                              : ReadStream(remaining, filter, profile, last_key, on_row);
+			if (status.ok()) {
+				return;
+			}
+			if (!IsTransient(status) || clock::now() + backoff > deadline) {
+				throw std::runtime_error(status.message());
+			}
+
+			ScanProfile::Add(profile.resumes, 1);
+			{
+				ProfileTimer timer(profile.throttle_ns);
+				thread_local std::minstd_rand jitter(std::random_device {}());
+				std::this_thread::sleep_for(backoff / 2 + backoff * (jitter() % 512) / 1024);
+			}
+			backoff = MinValue(backoff * 2, max_backoff);
+
+			if (last_key && !RowsAfter(rows, *last_key, remaining)) {
+				return;
+			}
+		}
+	}
+
+private:
+	static std::optional<std::string> PointKey(const cbt::RowRange &range) {
+		if (!IsPoint(range)) {
+			return std::nullopt;
+		}
+		return range.as_proto().start_key_closed();
+	}
+
+	// Narrows `remaining` to the rows after `last_key`, returns false when there are none left
+	static bool RowsAfter(const cbt::RowRange &range, const std::string &last_key, cbt::RowRange &remaining) {
+		auto rest = range.Intersect(cbt::RowRange::Open(last_key, ""));
+		if (!rest.first) {
+			return false;
+		}
+		remaining = std::move(rest.second);
+		return true;
+	}
+
+	// Returns the delay after which a point read is hedged, once enough point reads were timed to learn it
+	std::optional<std::chrono::microseconds> HedgeDelay() const;
+
+	// Reads one row under a stream slot, with the same accounting and error contract as ReadStream
+	template <class ON_ROW>
+	google::cloud::Status ReadPointStream(const std::string &row_key, const cbt::Filter &filter, ScanProfile &profile,
+	                                      ON_ROW &on_row) {
+		using clock = std::chrono::steady_clock;
+		std::optional<ConcurrencyLimiter::Slot> slot;
+		{
+			ProfileTimer timer(profile.throttle_ns);
+			slot.emplace(limiter);
+		}
+
+		StreamMetrics stream_metrics;
+		const auto start = clock::now();
+		auto result = ReadPoint(row_key, filter, profile);
+		const auto end = clock::now();
+		ScanProfile::Add(profile.stream_ns,
+		                 static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+		if (!result) {
+			stream_metrics.OnError(result.status());
+			slot->overloaded = IsTransient(result.status());
+			return result.status();
+		}
+		slot->first_byte_latency = end - start;
+		if (!result->first) {
+			return google::cloud::Status();
+		}
+
+		ProfileTimer timer(profile.decode_ns);
+		const cbt::Row &row = result->second;
+		const auto bytes = RowBytes(row);
+		stream_metrics.OnRow(bytes);
+		ScanProfile::Add(profile.rows, 1);
+		ScanProfile::Add(profile.cells, row.cells().size());
+		ScanProfile::Add(profile.bytes, bytes);
+		on_row(row);
+		return google::cloud::Status();
+	}
+
+	// Reads one stream, returning its final status instead of throwing so that the caller can resume
+	template <class ROWS, class ON_ROW>
+	google::cloud::Status ReadStream(const ROWS &rows, const cbt::Filter &filter, ScanProfile &profile,
+	                                 std::optional<std::string> &last_key, ON_ROW &on_row) {
+		using clock = std::chrono::steady_clock;
+		const auto elapsed_ns = [](clock::time_point from, clock::time_point to) {
+			return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+		};
+
+		std::optional<ConcurrencyLimiter::Slot> slot;
+		{
+			ProfileTimer timer(profile.throttle_ns);
+			slot.emplace(limiter);
+		}
+
+		ScanProfile::Add(profile.rpcs, 1);
+		StreamMetrics stream_metrics;
+		const auto stream_start = clock::now();
+		auto reader = table.ReadRows(rows, filter, profile.call_options);
+
+		auto wait_start = clock::now();
+		auto it = reader.begin();
+		while (true) {
+			const auto decode_start = clock::now();
+			ScanProfile::Add(profile.stream_ns, elapsed_ns(wait_start, decode_start));
+			if (!slot->first_byte_latency) {
+				slot->first_byte_latency = decode_start - stream_start;
+			}
+			if (it == reader.end()) {
+				return google::cloud::Status();
+			}
+			if (!*it) {
+				const auto status = it->status();
+				stream_metrics.OnError(status);
+				slot->first_byte_latency.reset();
+				slot->overloaded = IsTransient(status);
+				return status;
+			}
+
+			const cbt::Row &row = **it;
+			const auto bytes = RowBytes(row);
+			stream_metrics.OnRow(bytes);
+			ScanProfile::Add(profile.rows, 1);
+			ScanProfile::Add(profile.cells, row.cells().size());
+			ScanProfile::Add(profile.bytes, bytes);
+
+			on_row(row);
+			last_key = row.row_key();
+
+			wait_start = clock::now();
+			ScanProfile::Add(profile.decode_ns, elapsed_ns(decode_start, wait_start));
+			++it;
+		}
+	}
+};
+
+} // namespace duckdb
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include "sampling.hpp"
+
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// Hands out the row ranges of a scan to its threads, one range at a time, or one group of consecutive ranges at a
+// time for scans that need all the ranges of a group on the same thread. A scan sampled by range skips the groups
+// left out of its sample, keeping the indexes of the ranges it reads.
+struct RangeScheduler {
+	const vector<cbt::RowRange> ranges;
+	const idx_t group_size;
+	const ScanSample sample;
+	atomic<idx_t> ranges_idx {0};
+
+	explicit RangeScheduler(vector<cbt::RowRange> ranges_p, idx_t group_size_p = 1, ScanSample sample_p = {})
+	    : ranges(std::move(ranges_p)), group_size(MaxValue<idx_t>(group_size_p, 1)), sample(sample_p) {};
+
+	// Claims the next range or group, the first range of which is returned, returns false once every range has
+	// been claimed
+	bool Next(idx_t &range_idx) {
+		do {
+			range_idx = ranges_idx.fetch_add(group_size);
+		} while (range_idx < ranges.size() && !sample.Keep(range_idx / group_size));
+		return range_idx < ranges.size();
+	}
+
+	// One past the last range of the group starting at `range_idx`
+	idx_t GroupEnd(idx_t range_idx) const {
+		return MinValue(range_idx + group_size, ranges.size());
+	}
+
+	idx_t MaxThreads() const {
+		return (ranges.size() + group_size - 1) / group_size;
+	}
+
+	double Progress() const {
+		const auto total_count = ranges.size();
+		if (total_count == 0) {
+			return 100.0;
+		}
+		const auto completed = static_cast<double>(MinValue<idx_t>(ranges_idx.load(), total_count));
+		return (100.0 * completed) / static_cast<double>(total_count);
+	}
+};
+
+} // namespace duckdb
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <google/cloud/bigtable/data_connection.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// Wraps a data connection to append the rows of every successful ReadRows call to the file at `path`.
+// Streams are drained before being handed to the scan, so recording changes their timing but not their rows.
+std::shared_ptr<cbt::DataConnection> MakeRecordingConnection(std::shared_ptr<cbt::DataConnection> inner,
+                                                             const string &path);
+
+// Serves the ReadRows calls recorded at `path` without any network access, delaying each stream by
+// `latency_ms`. Requests that were not recorded fail with NOT_FOUND.
+std::shared_ptr<cbt::DataConnection> MakeReplayConnection(const string &path, idx_t latency_ms);
+
+} // namespace duckdb
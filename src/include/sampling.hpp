@@ -0,0 +1,34 @@
+#pragma once
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "duckdb/parser/parsed_data/sample_options.hpp"
+
+#include <google/cloud/bigtable/filters.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// A TABLESAMPLE percentage pushed into a scan. Rows are sampled by Bigtable with a row sample filter, or, with
+// `bigtable_sample_ranges`, whole ranges are skipped by the scheduler so that they are never requested at all.
+struct ScanSample {
+	// Share of the rows or ranges kept, 1 when the scan is not sampled
+	double rate = 1;
+	bool by_range = false;
+	uint64_t seed = 0;
+
+	static ScanSample Get(const BigtableConfig &config, optional_ptr<SampleOptions> options);
+
+	bool IsSampled() const {
+		return rate < 1;
+	}
+
+	// Prepends the row sample to the filter of a scan that samples rows
+	cbt::Filter Apply(cbt::Filter filter) const;
+
+	// Whether the range or group of ranges at `group_idx` is read, the same for the same seed
+	bool Keep(idx_t group_idx) const;
+};
+
+} // namespace duckdb
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+unique_ptr<FunctionData> BigtableScanFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> BigtableScanInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> BigtableScanInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state);
+
+void BigtableScanFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+double BigtableScanProgress(ClientContext &context, const FunctionData *bind_data,
+                            const GlobalTableFunctionState *global_state);
+
+InsertionOrderPreservingMap<string> BigtableScanDynamicToString(TableFunctionDynamicToStringInput &input);
+
+} // namespace duckdb
@@ -17,7 +17,24 @@ void SearchFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 double SearchScanProgress(ClientContext &context, const FunctionData *bind_data,
                           const GlobalTableFunctionState *global_state);
 
+InsertionOrderPreservingMap<string> SearchDynamicToString(TableFunctionDynamicToStringInput &input);
+
+TablePartitionInfo SearchPartitionInfo(ClientContext &context, TableFunctionPartitionInput &input);
+
+OperatorPartitionData SearchPartitionData(ClientContext &context, TableFunctionGetPartitionInput &input);
+
+unique_ptr<NodeStatistics> SearchCardinality(ClientContext &context, const FunctionData *bind_data);
+
 unique_ptr<BaseStatistics> SearchStatistics(ClientContext &context, const FunctionData *bind_data,
                                             column_t column_index);
 
+unique_ptr<FunctionData> SearchRankedFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names);
+unique_ptr<GlobalTableFunctionState> SearchRankedInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+unique_ptr<LocalTableFunctionState> SearchRankedInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state);
+void SearchRankedFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+unique_ptr<NodeStatistics> SearchRankedCardinality(ClientContext &context, const FunctionData *bind_data);
+
 } // namespace duckdb
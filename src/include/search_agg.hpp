@@ -0,0 +1,22 @@
+#pragma once
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+unique_ptr<FunctionData> SearchAggFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                               vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> SearchAggInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> SearchAggInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                       GlobalTableFunctionState *global_state);
+
+void SearchAggFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output);
+
+double SearchAggScanProgress(ClientContext &context, const FunctionData *bind_data,
+                             const GlobalTableFunctionState *global_state);
+
+InsertionOrderPreservingMap<string> SearchAggDynamicToString(TableFunctionDynamicToStringInput &input);
+
+} // namespace duckdb
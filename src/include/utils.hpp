@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <optional>
+#include <string>
 #include <string_view>
 
 // Declarations for parsing utility functions.
@@ -19,5 +20,17 @@ std::optional<uint32_t> ParseUint32(std::string_view s);
 // Parses a string_view into an optional uint64_t.
 std::optional<uint64_t> ParseUint64(std::string_view s);
 
+// Parses a string_view into an optional int32_t.
+std::optional<int32_t> ParseInt32(std::string_view s);
+
+// Parses a string_view into an optional int64_t.
+std::optional<int64_t> ParseInt64(std::string_view s);
+
 // Parses a string_view into an optional float.
 std::optional<float> ParseFloat(std::string_view s);
+
+// Parses a string_view into an optional double.
+std::optional<double> ParseDouble(std::string_view s);
+
+// Formats a float into its shortest round-trip representation, the inverse of ParseFloat.
+std::string FormatFloat(float value);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "duckdb.hpp"
+#include <google/cloud/bigtable/table.h>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+unique_ptr<FunctionData> WriteFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                           vector<LogicalType> &return_types, vector<string> &names);
+
+unique_ptr<GlobalTableFunctionState> WriteInitGlobal(ClientContext &context, TableFunctionInitInput &input);
+
+unique_ptr<LocalTableFunctionState> WriteInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                   GlobalTableFunctionState *global_state);
+
+OperatorResultType WriteFunction(ExecutionContext &context, TableFunctionInput &data, DataChunk &input,
+                                 DataChunk &output);
+
+OperatorFinalizeResultType WriteFunctionFinal(ExecutionContext &context, TableFunctionInput &data, DataChunk &output);
+
+} // namespace duckdb
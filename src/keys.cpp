@@ -0,0 +1,37 @@
+#include "keys.hpp"
+
+#include "duckdb.hpp"
+
+namespace duckdb {
+
+string ReverseId(uint64_t id) {
+	string result = std::to_string(id);
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+int32_t WeekKey(date_t date) {
+	int32_t year, week;
+	Date::ExtractISOYearWeek(date, year, week);
+	return year * 100 + week;
+}
+
+date_t WeekStart(int32_t week) {
+	// January 4th always falls in week 1 of its ISO year
+	const auto january_4 = Date::FromDate(week / 100, 1, 4);
+	const auto week_1 = january_4.days - (Date::ExtractISODayOfTheWeek(january_4) - 1);
+	return date_t(week_1 + (week % 100 - 1) * 7);
+}
+
+idx_t WeekCount(int32_t week_start, int32_t week_end) {
+	if (week_end < week_start) {
+		return 0;
+	}
+	return static_cast<idx_t>((WeekStart(week_end).days - WeekStart(week_start).days) / 7 + 1);
+}
+
+string MakeRowKey(uint64_t id, int32_t week, uint32_t shop_id) {
+	return ReverseId(id) + "/" + std::to_string(week) + "/" + std::to_string(shop_id);
+}
+
+} // namespace duckdb
@@ -0,0 +1,252 @@
+#include "metrics.hpp"
+
+#include "duckdb.hpp"
+
+#include <bit>
+#include <google/cloud/status.h>
+
+namespace duckdb {
+
+static int64_t NowMicros() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+	    .count();
+}
+
+idx_t LatencyHistogram::BucketIndex(uint64_t value) {
+	if (value < SUB_BUCKETS) {
+		return value;
+	}
+	const idx_t shift = std::bit_width(value) - 1 - SUB_BUCKET_BITS;
+	const idx_t sub_bucket = (value >> shift) - SUB_BUCKETS;
+	return (shift + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(idx_t index) {
+	if (index < SUB_BUCKETS) {
+		return index;
+	}
+	const idx_t shift = index / SUB_BUCKETS - 1;
+	const uint64_t top = SUB_BUCKETS + index % SUB_BUCKETS;
+	return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value) {
+	counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+	auto current = max.load(std::memory_order_relaxed);
+	while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+	}
+}
+
+void LatencyHistogram::Reset() {
+	for (auto &count : counts) {
+		count.store(0, std::memory_order_relaxed);
+	}
+	max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Count() const {
+	uint64_t total = 0;
+	for (const auto &count : counts) {
+		total += count.load(std::memory_order_relaxed);
+	}
+	return total;
+}
+
+uint64_t LatencyHistogram::Max() const {
+	return max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Quantile(double quantile) const {
+	const auto total = Count();
+	if (total == 0) {
+		return 0;
+	}
+	const auto rank = MaxValue<uint64_t>(static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(total))), 1);
+	uint64_t seen = 0;
+	for (idx_t i = 0; i < BUCKETS; i++) {
+		seen += counts[i].load(std::memory_order_relaxed);
+		if (seen >= rank) {
+			return MinValue(BucketUpperBound(i), Max());
+		}
+	}
+	return Max();
+}
+
+BigtableMetrics::BigtableMetrics() : since_us(NowMicros()) {
+}
+
+BigtableMetrics &BigtableMetrics::Get() {
+	static BigtableMetrics metrics;
+	return metrics;
+}
+
+void BigtableMetrics::Reset() {
+	first_byte_us.Reset();
+	completion_us.Reset();
+	point_read_us.Reset();
+	point_race_us.Reset();
+	point_reads.store(0, std::memory_order_relaxed);
+	hedges.store(0, std::memory_order_relaxed);
+	streams.store(0, std::memory_order_relaxed);
+	rows.store(0, std::memory_order_relaxed);
+	bytes.store(0, std::memory_order_relaxed);
+	for (auto &error : errors) {
+		error.store(0, std::memory_order_relaxed);
+	}
+	// Gauges keep their value, only the peak starts over
+	peak_active_streams.store(active_streams.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	since_us.store(NowMicros(), std::memory_order_relaxed);
+}
+
+StreamMetrics::StreamMetrics() : metrics(BigtableMetrics::Get()), start(std::chrono::steady_clock::now()) {
+	metrics.streams.fetch_add(1, std::memory_order_relaxed);
+	const auto active = metrics.active_streams.fetch_add(1, std::memory_order_relaxed) + 1;
+	auto peak = metrics.peak_active_streams.load(std::memory_order_relaxed);
+	while (active > peak && !metrics.peak_active_streams.compare_exchange_weak(peak, active, std::memory_order_relaxed)) {
+	}
+}
+
+StreamMetrics::~StreamMetrics() {
+	metrics.active_streams.fetch_sub(1, std::memory_order_relaxed);
+	metrics.rows.fetch_add(rows, std::memory_order_relaxed);
+	metrics.bytes.fetch_add(bytes, std::memory_order_relaxed);
+	if (failed) {
+		return;
+	}
+	// An empty range still waits for the server's end of stream
+	RecordFirstByte();
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	metrics.completion_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void StreamMetrics::RecordFirstByte() {
+	if (first_byte) {
+		return;
+	}
+	first_byte = true;
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+	metrics.first_byte_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+void StreamMetrics::OnRow(uint64_t row_bytes) {
+	RecordFirstByte();
+	rows++;
+	bytes += row_bytes;
+}
+
+void StreamMetrics::OnError(const google::cloud::Status &status) {
+	failed = true;
+	const auto code = static_cast<idx_t>(status.code());
+	metrics.errors[MinValue(code, BigtableMetrics::STATUS_CODES - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+struct MetricsGlobalState : GlobalTableFunctionState {
+	vector<std::pair<string, double>> metrics;
+	idx_t offset = 0;
+};
+
+unique_ptr<FunctionData> MetricsFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                             vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"metric", "value"};
+	return_types = {LogicalType::VARCHAR, LogicalType::DOUBLE};
+	return make_uniq<TableFunctionData>();
+}
+
+static void AddLatency(vector<std::pair<string, double>> &metrics, const string &name,
+                       const LatencyHistogram &histogram) {
+	metrics.emplace_back(name + "_p50_ms", histogram.Quantile(0.5) / 1000.0);
+	metrics.emplace_back(name + "_p99_ms", histogram.Quantile(0.99) / 1000.0);
+	metrics.emplace_back(name + "_p999_ms", histogram.Quantile(0.999) / 1000.0);
+	metrics.emplace_back(name + "_max_ms", histogram.Max() / 1000.0);
+}
+
+unique_ptr<GlobalTableFunctionState> MetricsInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	const auto &metrics = BigtableMetrics::Get();
+	auto global_state = make_uniq<MetricsGlobalState>();
+	auto &result = global_state->metrics;
+
+	const auto seconds =
+	    MaxValue<double>(static_cast<double>(NowMicros() - metrics.since_us.load(std::memory_order_relaxed)) / 1e6, 1e-6);
+	const auto streams = static_cast<double>(metrics.streams.load(std::memory_order_relaxed));
+	const auto active = static_cast<double>(metrics.active_streams.load(std::memory_order_relaxed));
+	const auto peak = static_cast<double>(metrics.peak_active_streams.load(std::memory_order_relaxed));
+	const auto channels = static_cast<double>(metrics.channels.load(std::memory_order_relaxed));
+	const auto bytes = static_cast<double>(metrics.bytes.load(std::memory_order_relaxed));
+
+	result.emplace_back("uptime_s", seconds);
+	result.emplace_back("streams", streams);
+	result.emplace_back("streams_active", active);
+	result.emplace_back("streams_active_peak", peak);
+	result.emplace_back("channels", channels);
+	result.emplace_back("channel_utilization", channels > 0 ? active / channels : 0.0);
+	result.emplace_back("channel_utilization_peak", channels > 0 ? peak / channels : 0.0);
+	result.emplace_back("rows", static_cast<double>(metrics.rows.load(std::memory_order_relaxed)));
+	result.emplace_back("bytes", bytes);
+	result.emplace_back("bytes_per_s", bytes / seconds);
+	AddLatency(result, "first_byte", metrics.first_byte_us);
+	AddLatency(result, "completion", metrics.completion_us);
+	AddLatency(result, "point_read", metrics.point_read_us);
+	AddLatency(result, "point_race", metrics.point_race_us);
+	const auto point_reads = static_cast<double>(metrics.point_reads.load(std::memory_order_relaxed));
+	const auto hedges = static_cast<double>(metrics.hedges.load(std::memory_order_relaxed));
+	result.emplace_back("point_reads", point_reads);
+	result.emplace_back("hedges", hedges);
+	result.emplace_back("hedge_rate", point_reads > 0 ? hedges / point_reads : 0.0);
+
+	uint64_t errors = 0;
+	for (idx_t code = 1; code < BigtableMetrics::STATUS_CODES; code++) {
+		const auto count = metrics.errors[code].load(std::memory_order_relaxed);
+		if (count > 0) {
+			const auto name = google::cloud::StatusCodeToString(static_cast<google::cloud::StatusCode>(code));
+			result.emplace_back("errors_" + name, static_cast<double>(count));
+			errors += count;
+		}
+	}
+	result.emplace_back("errors", static_cast<double>(errors));
+	result.emplace_back("error_rate", streams > 0 ? static_cast<double>(errors) / streams : 0.0);
+	return std::move(global_state);
+}
+
+void MetricsFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<MetricsGlobalState>();
+	const auto count = MinValue<idx_t>(STANDARD_VECTOR_SIZE, global_state.metrics.size() - global_state.offset);
+
+	auto *names = FlatVector::GetData<string_t>(output.data[0]);
+	auto *values = FlatVector::GetData<double>(output.data[1]);
+	for (idx_t i = 0; i < count; i++) {
+		const auto &metric = global_state.metrics[global_state.offset + i];
+		names[i] = StringVector::AddString(output.data[0], metric.first);
+		values[i] = metric.second;
+	}
+	global_state.offset += count;
+	output.SetCardinality(count);
+}
+
+struct MetricsResetGlobalState : GlobalTableFunctionState {
+	bool done = false;
+};
+
+unique_ptr<FunctionData> MetricsResetFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"success"};
+	return_types = {LogicalType::BOOLEAN};
+	return make_uniq<TableFunctionData>();
+}
+
+unique_ptr<GlobalTableFunctionState> MetricsResetInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	return make_uniq<MetricsResetGlobalState>();
+}
+
+void MetricsResetFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<MetricsResetGlobalState>();
+	if (global_state.done) {
+		output.SetCardinality(0);
+		return;
+	}
+	BigtableMetrics::Get().Reset();
+	FlatVector::GetData<bool>(output.data[0])[0] = true;
+	output.SetCardinality(1);
+	global_state.done = true;
+}
+
+} // namespace duckdb
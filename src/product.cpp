@@ -1,15 +1,21 @@
 #include "product.hpp"
 
+#include "cardinality.hpp"
+#include "config.hpp"
 #include "duckdb.hpp"
+#include "keys.hpp"
+#include "metrics.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "sampling.hpp"
 #include "utils.hpp"
 
+#include <deque>
 #include <google/cloud/bigtable/table.h>
 #include <optional>
 #include <string_view>
 
-using ::google::cloud::GrpcNumChannelsOption;
-using ::google::cloud::Options;
-using ::google::cloud::StatusOr;
 namespace cbt = ::google::cloud::bigtable;
 
 namespace duckdb {
@@ -43,33 +49,49 @@ struct Product {
 };
 
 struct ProductFunctionData : TableFunctionData {
+	BigtableConfig config;
 	vector<uint64_t> pe_ids;
 	vector<uint32_t> shop_ids;
 	vector<cbt::RowRange> ranges;
+	int32_t week_start;
+	int32_t week_end;
+	// Weeks read by each range, a single one for the point ranges of given shops
+	idx_t range_weeks;
+	optional_ptr<RowEstimate> estimate;
 };
 
 static cbt::Filter make_filter(const vector<column_t> &column_ids);
 
+static vector<string> ProductNames() {
+	return {"pe_id",    "shop_id",    "date",     "price",    "base_price", "unit_price",
+	        "promo_id", "promo_text", "shelf_id", "position", "is_paid"};
+}
+
+static vector<LogicalType> ProductTypes() {
+	return {LogicalType::UBIGINT,
+	        LogicalType::UINTEGER,
+	        LogicalType::DATE,
+	        LogicalType::FLOAT,
+	        LogicalType::FLOAT,
+	        LogicalType::FLOAT,
+	        LogicalType::UINTEGER,
+	        LogicalType::VARCHAR,
+	        LogicalType::LIST(LogicalType::VARCHAR),
+	        LogicalType::LIST(LogicalType::USMALLINT),
+	        LogicalType::LIST(LogicalType::BOOLEAN)};
+}
+
 unique_ptr<FunctionData> ProductFunctionBind(ClientContext &context, TableFunctionBindInput &input,
                                              vector<LogicalType> &return_types, vector<string> &names) {
-	names = {"pe_id",    "shop_id",    "date",  "price",    "base_price", "unit_price",
-	         "promo_id", "promo_text", "shelf_id", "position", "is_paid"};
-
-	return_types = {LogicalType::UBIGINT,
-	                LogicalType::UINTEGER,
-	                LogicalType::DATE,
-	                LogicalType::FLOAT,
-	                LogicalType::FLOAT,
-	                LogicalType::FLOAT,
-	                LogicalType::UINTEGER,
-	                LogicalType::VARCHAR,
-	                LogicalType::LIST(LogicalType::VARCHAR),
-	                LogicalType::LIST(LogicalType::USMALLINT),
-	                LogicalType::LIST(LogicalType::BOOLEAN)};
+	names = ProductNames();
+	return_types = ProductTypes();
 
 	auto bind_data = make_uniq<ProductFunctionData>();
-	const auto week_start = std::to_string(IntegerValue::Get(input.inputs[0]));
-	const auto week_end = std::to_string(IntegerValue::Get(input.inputs[1]));
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "product"));
+	bind_data->week_start = IntegerValue::Get(input.inputs[0]);
+	bind_data->week_end = IntegerValue::Get(input.inputs[1]);
+	const auto week_start = std::to_string(bind_data->week_start);
+	const auto week_end = std::to_string(bind_data->week_end);
 	const auto &ls_pe_id = ListValue::GetChildren(input.inputs[2]);
 
 	vector<string> prefix_ids;
@@ -79,12 +101,14 @@ unique_ptr<FunctionData> ProductFunctionBind(ClientContext &context, TableFuncti
 	for (const auto &p : ls_pe_id) {
 		const auto pe_id = BigIntValue::Get(p);
 		bind_data->pe_ids.emplace_back(pe_id);
-		string prefix_id = std::to_string(pe_id);
-		std::reverse(prefix_id.begin(), prefix_id.end());
-		prefix_ids.emplace_back(std::move(prefix_id));
+		prefix_ids.emplace_back(ReverseId(pe_id));
 	}
 
-	if (input.inputs.size() == 4) {
+	const bool point = input.inputs.size() == 4;
+	bind_data->range_weeks = point ? 1 : WeekCount(bind_data->week_start, bind_data->week_end);
+	bind_data->estimate = &RowEstimate::Get(bind_data->config, point ? "point" : "span");
+
+	if (point) {
 		const auto &ls_shop_id = ListValue::GetChildren(input.inputs[3]);
 		bind_data->shop_ids.reserve(ls_shop_id.size());
 		bind_data->ranges.reserve(prefix_ids.size() * ls_shop_id.size());
@@ -113,40 +137,243 @@ unique_ptr<FunctionData> ProductFunctionBind(ClientContext &context, TableFuncti
 
 struct ProductGlobalState : GlobalTableFunctionState {
 	const cbt::Filter filter;
-	cbt::Table table;
+	RangeReader reader;
 
-	mutex lock;
-	idx_t ranges_idx = 0;
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
 	const vector<uint64_t> pe_ids;
-	const vector<cbt::RowRange> ranges;
 	const vector<column_t> column_ids;
-
-	ProductGlobalState(vector<uint64_t> pe_ids_p, vector<cbt::RowRange> ranges_p, vector<column_t> column_ids_p)
-	    : filter(make_filter(column_ids_p)),
-	      table(cbt::MakeDataConnection(Options {}.set<GrpcNumChannelsOption>(32)),
-	            cbt::TableResource("dataimpact-processing", "processing", "product")),
-	      pe_ids(std::move(pe_ids_p)), ranges(std::move(ranges_p)), column_ids(std::move(column_ids_p)) {};
+	ScanProfiles profiles;
+	RowEstimate &estimate;
+	const idx_t range_weeks;
+	// Ranges read to the end and the rows decoded from them, emitted or not
+	atomic<idx_t> ranges_read {0};
+	atomic<idx_t> rows_read {0};
+
+	ProductGlobalState(const BigtableConfig &config, vector<uint64_t> pe_ids_p, vector<cbt::RowRange> ranges_p,
+	                   vector<column_t> column_ids_p, RowEstimate &estimate_p, idx_t range_weeks_p, ScanSample sample)
+	    : filter(sample.Apply(make_filter(column_ids_p))), reader(config), scheduler(std::move(ranges_p), 1, sample),
+	      max_inflight(config.max_inflight), pe_ids(std::move(pe_ids_p)), column_ids(std::move(column_ids_p)),
+	      profiles(config), estimate(estimate_p), range_weeks(range_weeks_p) {};
+
+	~ProductGlobalState() override {
+		// A scan stopped early by a LIMIT or an error, or sampled, says nothing about the rows of its ranges
+		if (ranges_read.load() == scheduler.ranges.size() && !scheduler.sample.IsSampled()) {
+			estimate.Learn(scheduler.ranges.size() * range_weeks, rows_read.load());
+		}
+	}
 
 	idx_t MaxThreads() const override {
-		return ranges.size();
+		return MinValue(scheduler.MaxThreads(), max_inflight);
 	}
 };
 
 unique_ptr<GlobalTableFunctionState> ProductInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
 	auto &bind_data = input.bind_data->Cast<ProductFunctionData>();
-	return make_uniq<ProductGlobalState>(std::move(bind_data.pe_ids), std::move(bind_data.ranges),
-	                                     std::move(input.column_ids));
+	auto sample = ScanSample::Get(bind_data.config, input.sample_options);
+	return make_uniq<ProductGlobalState>(bind_data.config, std::move(bind_data.pe_ids), std::move(bind_data.ranges),
+	                                     std::move(input.column_ids), *bind_data.estimate, bind_data.range_weeks,
+	                                     sample);
 }
 
 struct ProductLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
 	idx_t remainder_idx = 0;
 	vector<Product> remainder;
 	std::array<std::optional<Product>, 7> product_week;
+
+	explicit ProductLocalState(ScanProfile &profile_p) : profile(profile_p) {};
 };
 
 unique_ptr<LocalTableFunctionState> ProductInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
                                                      GlobalTableFunctionState *global_state) {
-	return make_uniq<ProductLocalState>();
+	return make_uniq<ProductLocalState>(global_state->Cast<ProductGlobalState>().profiles.Register());
+}
+
+// Folds the cells of a row into the days of its week, which hold no product until a cell of theirs is read
+static void DecodeWeek(uint64_t pe_id, uint32_t shop_id, const cbt::Row &row,
+                       std::array<std::optional<Product>, 7> &product_week) {
+	for (const auto &cell : row.cells()) {
+		const date_t date = Date::EpochToDate(cell.timestamp().count() / 1'000'000);
+		const int32_t weekday = Date::ExtractISODayOfTheWeek(date) - 1;
+
+		auto &product_day = product_week[weekday];
+		if (!product_day) {
+			product_day.emplace();
+			product_day->pe_id = pe_id;
+			product_day->shop_id = shop_id;
+			product_day->date = date;
+		}
+
+		const std::string_view family = cell.family_name();
+		const std::string_view qualifier = cell.column_qualifier();
+		const std::string_view value = cell.value();
+
+		switch (family[0]) {
+		case 'p':
+			switch (qualifier[0]) {
+			case 'p':
+				product_day->price = ParseFloat(value);
+				break;
+			case 'b':
+				product_day->base_price = ParseFloat(value);
+				break;
+			case 'u':
+				product_day->unit_price = ParseFloat(value);
+				break;
+			}
+			break;
+		case 'd':
+			product_day->promo_id = ParseUint32(qualifier);
+			product_day->promo_text = string(value);
+			break;
+		case 's':
+		case 'S':
+			if (auto pos = ParseUint16(value)) {
+				product_day->shelf.emplace_back(qualifier);
+				product_day->position.emplace_back(*pos);
+				product_day->is_paid.emplace_back(family[0] == 'S');
+			}
+			break;
+		}
+	}
+}
+
+// Writes one column of `count` products, the i-th of which is returned by `product(i)`
+template <class GET_PRODUCT>
+static void WriteProductColumn(ProductColumn column, Vector &out_vec, idx_t count, GET_PRODUCT &&product) {
+	switch (column) {
+	case ProductColumn::PE_ID: {
+		auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			data_ptr[i] = product(i).pe_id;
+		}
+		break;
+	}
+	case ProductColumn::SHOP_ID: {
+		auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			data_ptr[i] = product(i).shop_id;
+		}
+		break;
+	}
+	case ProductColumn::DATE: {
+		auto data_ptr = FlatVector::GetData<date_t>(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			data_ptr[i] = product(i).date;
+		}
+		break;
+	}
+	case ProductColumn::PRICE: {
+		auto data_ptr = FlatVector::GetData<float>(out_vec);
+		auto &validity = FlatVector::Validity(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			if (product(i).price) {
+				data_ptr[i] = *product(i).price;
+			} else {
+				validity.SetInvalid(i);
+			}
+		}
+		break;
+	}
+	case ProductColumn::BASE_PRICE: {
+		auto data_ptr = FlatVector::GetData<float>(out_vec);
+		auto &validity = FlatVector::Validity(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			if (product(i).base_price) {
+				data_ptr[i] = *product(i).base_price;
+			} else {
+				validity.SetInvalid(i);
+			}
+		}
+		break;
+	}
+	case ProductColumn::UNIT_PRICE: {
+		auto data_ptr = FlatVector::GetData<float>(out_vec);
+		auto &validity = FlatVector::Validity(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			if (product(i).unit_price) {
+				data_ptr[i] = *product(i).unit_price;
+			} else {
+				validity.SetInvalid(i);
+			}
+		}
+		break;
+	}
+	case ProductColumn::PROMO_ID: {
+		auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+		auto &validity = FlatVector::Validity(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			if (product(i).promo_id) {
+				data_ptr[i] = *product(i).promo_id;
+			} else {
+				validity.SetInvalid(i);
+			}
+		}
+		break;
+	}
+	case ProductColumn::PROMO_TEXT: {
+		auto *data_ptr = FlatVector::GetData<string_t>(out_vec);
+		auto &validity = FlatVector::Validity(out_vec);
+		for (idx_t i = 0; i < count; i++) {
+			if (product(i).promo_text) {
+				data_ptr[i] = StringVector::AddString(out_vec, *product(i).promo_text);
+			} else {
+				validity.SetInvalid(i);
+			}
+		}
+		break;
+	}
+	case ProductColumn::SHELF_ID: {
+		auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
+		idx_t total = 0;
+		for (idx_t i = 0; i < count; i++) total += product(i).shelf.size();
+		ListVector::Reserve(out_vec, total);
+		auto &child = ListVector::GetEntry(out_vec);
+		auto *child_data = FlatVector::GetData<string_t>(child);
+		idx_t offset = 0;
+		for (idx_t i = 0; i < count; i++) {
+			list_data[i] = {offset, product(i).shelf.size()};
+			for (const auto &s : product(i).shelf) {
+				child_data[offset++] = StringVector::AddString(child, s);
+			}
+		}
+		ListVector::SetListSize(out_vec, total);
+		break;
+	}
+	case ProductColumn::POSITION: {
+		auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
+		idx_t total = 0;
+		for (idx_t i = 0; i < count; i++) total += product(i).position.size();
+		ListVector::Reserve(out_vec, total);
+		auto *child_data = FlatVector::GetData<uint16_t>(ListVector::GetEntry(out_vec));
+		idx_t offset = 0;
+		for (idx_t i = 0; i < count; i++) {
+			list_data[i] = {offset, product(i).position.size()};
+			for (const auto p : product(i).position) {
+				child_data[offset++] = p;
+			}
+		}
+		ListVector::SetListSize(out_vec, total);
+		break;
+	}
+	case ProductColumn::IS_PAID: {
+		auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
+		idx_t total = 0;
+		for (idx_t i = 0; i < count; i++) total += product(i).is_paid.size();
+		ListVector::Reserve(out_vec, total);
+		auto *child_data = FlatVector::GetData<bool>(ListVector::GetEntry(out_vec));
+		idx_t offset = 0;
+		for (idx_t i = 0; i < count; i++) {
+			list_data[i] = {offset, product(i).is_paid.size()};
+			for (idx_t j = 0; j < product(i).is_paid.size(); j++) {
+				child_data[offset++] = product(i).is_paid[j];
+			}
+		}
+		ListVector::SetListSize(out_vec, total);
+		break;
+	}
+	}
 }
 
 void ProductFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
@@ -155,74 +382,26 @@ void ProductFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 
 	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
 		idx_t range_idx;
-		{
-			lock_guard<mutex> guard(global_state.lock);
-			if (global_state.ranges_idx == global_state.ranges.size()) {
-				break;
-			}
-			range_idx = global_state.ranges_idx++;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
 		}
 
-		const auto pe_id = global_state.pe_ids[range_idx];
-		const auto &range = global_state.ranges[range_idx];
-
-		for (const StatusOr<cbt::Row> &row_result : global_state.table.ReadRows(range, global_state.filter)) {
-			if (!row_result)
-				throw std::runtime_error(row_result.status().message());
+		// Ranges are laid out shop by shop, each covering every pe_id in order
+		const auto pe_id = global_state.pe_ids[range_idx % global_state.pe_ids.size()];
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		const auto rows_before = local_state.remainder.size();
 
-			const auto &row = row_result.value();
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
 			std::string_view row_key = row.row_key();
 			const auto index = row_key.find_last_of('/');
 			const auto shop_id_opt = ParseUint32(row_key.substr(index + 1));
 			if (!shop_id_opt) {
-				continue;
+				ScanProfile::Add(local_state.profile.filtered, 1);
+				return;
 			}
 			const auto shop_id = *shop_id_opt;
 
-			for (const auto &cell : row.cells()) {
-				const date_t date = Date::EpochToDate(cell.timestamp().count() / 1'000'000);
-				const int32_t weekday = Date::ExtractISODayOfTheWeek(date) - 1;
-
-				auto &product_day = local_state.product_week[weekday];
-				if (!product_day) {
-					product_day.emplace();
-					product_day->pe_id = pe_id;
-					product_day->shop_id = shop_id;
-					product_day->date = date;
-				}
-
-				const std::string_view family = cell.family_name();
-				const std::string_view qualifier = cell.column_qualifier();
-				const std::string_view value = cell.value();
-
-				switch (family[0]) {
-				case 'p':
-					switch (qualifier[0]) {
-					case 'p':
-						product_day->price = ParseFloat(value);
-						break;
-					case 'b':
-						product_day->base_price = ParseFloat(value);
-						break;
-					case 'u':
-						product_day->unit_price = ParseFloat(value);
-						break;
-					}
-					break;
-				case 'd':
-					product_day->promo_id = ParseUint32(qualifier);
-					product_day->promo_text = string(value);
-					break;
-				case 's':
-				case 'S':
-					if (auto pos = ParseUint16(value)) {
-						product_day->shelf.emplace_back(qualifier);
-						product_day->position.emplace_back(*pos);
-						product_day->is_paid.emplace_back(family[0] == 'S');
-					}
-					break;
-				}
-			}
+			DecodeWeek(pe_id, shop_id, row, local_state.product_week);
 
 			for (auto &product_opt : local_state.product_week) {
 				if (product_opt) {
@@ -230,7 +409,9 @@ void ProductFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 					product_opt.reset();
 				}
 			}
-		}
+		});
+		global_state.rows_read.fetch_add(local_state.remainder.size() - rows_before, std::memory_order_relaxed);
+		global_state.ranges_read.fetch_add(1, std::memory_order_relaxed);
 	}
 
 	const idx_t count = std::min((idx_t)STANDARD_VECTOR_SIZE, local_state.remainder.size() - local_state.remainder_idx);
@@ -242,159 +423,368 @@ void ProductFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 		return;
 	}
 
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
 	const auto *products = &local_state.remainder[local_state.remainder_idx];
 
 	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
-		auto &out_vec = output.data[col_idx];
-		const auto column_id = global_state.column_ids[col_idx];
+		WriteProductColumn(static_cast<ProductColumn>(global_state.column_ids[col_idx]), output.data[col_idx], count,
+		                   [&](idx_t i) -> const Product & { return products[i]; });
+	}
 
-		switch (static_cast<ProductColumn>(column_id)) {
-		case ProductColumn::PE_ID: {
-			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				data_ptr[i] = products[i].pe_id;
-			}
-			break;
+	local_state.remainder_idx += count;
+	output.SetCardinality(count);
+}
+
+double ProductScanProgress(ClientContext &context, const FunctionData *bind_data,
+                           const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<ProductGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> ProductDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<ProductGlobalState>().profiles.ToMap();
+}
+
+// Product columns appended by product_lookup to the columns of its input, after the date when the input gives weeks
+static const ProductColumn LOOKUP_COLUMNS[] = {ProductColumn::PRICE,      ProductColumn::BASE_PRICE,
+                                               ProductColumn::UNIT_PRICE, ProductColumn::PROMO_ID,
+                                               ProductColumn::PROMO_TEXT, ProductColumn::SHELF_ID,
+                                               ProductColumn::POSITION,   ProductColumn::IS_PAID};
+
+struct ProductLookupFunctionData : TableFunctionData {
+	BigtableConfig config;
+	idx_t pe_id_idx;
+	idx_t shop_id_idx;
+	// Input column of the date looked up, or of the YYYYWW week all the days of which are looked up
+	idx_t when_idx;
+	bool by_week;
+	idx_t input_columns;
+	vector<column_t> product_columns;
+	// Input chunks batched ahead of the one being emitted, per thread
+	idx_t max_inflight = 4;
+};
+
+unique_ptr<FunctionData> ProductLookupFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                   vector<LogicalType> &return_types, vector<string> &names) {
+	auto bind_data = make_uniq<ProductLookupFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "product"));
+	for (const auto &param : input.named_parameters) {
+		if (param.first == "max_inflight") {
+			bind_data->max_inflight = UBigIntValue::Get(param.second);
 		}
-		case ProductColumn::SHOP_ID: {
-			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				data_ptr[i] = products[i].shop_id;
+	}
+	if (bind_data->max_inflight == 0) {
+		throw BinderException("product_lookup: max_inflight must be positive");
+	}
+
+	const auto find_input = [&](const char *name) {
+		for (idx_t i = 0; i < input.input_table_names.size(); i++) {
+			if (StringUtil::CIEquals(input.input_table_names[i], name)) {
+				return i;
 			}
-			break;
 		}
-		case ProductColumn::DATE: {
-			auto data_ptr = FlatVector::GetData<date_t>(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				data_ptr[i] = products[i].date;
+		return DConstants::INVALID_INDEX;
+	};
+	bind_data->pe_id_idx = find_input("pe_id");
+	bind_data->shop_id_idx = find_input("shop_id");
+	bind_data->when_idx = find_input("date");
+	bind_data->by_week = bind_data->when_idx == DConstants::INVALID_INDEX;
+	if (bind_data->by_week) {
+		bind_data->when_idx = find_input("week");
+	}
+	if (bind_data->pe_id_idx == DConstants::INVALID_INDEX || bind_data->shop_id_idx == DConstants::INVALID_INDEX ||
+	    bind_data->when_idx == DConstants::INVALID_INDEX) {
+		throw BinderException("product_lookup: input needs pe_id, shop_id and either a date or a week column");
+	}
+
+	// Input columns are passed through, so the looked up rows are already joined to the rows that asked for them
+	names = input.input_table_names;
+	return_types = input.input_table_types;
+	bind_data->input_columns = names.size();
+	if (bind_data->by_week) {
+		bind_data->product_columns.push_back(ProductColumn::DATE);
+	}
+	for (const auto column : LOOKUP_COLUMNS) {
+		bind_data->product_columns.push_back(column);
+	}
+
+	const auto product_names = ProductNames();
+	const auto product_types = ProductTypes();
+	for (const auto column : bind_data->product_columns) {
+		for (const auto &name : input.input_table_names) {
+			if (StringUtil::CIEquals(name, product_names[column])) {
+				throw BinderException("product_lookup: input column \"%s\" clashes with a product column", name);
 			}
-			break;
 		}
-		case ProductColumn::PRICE: {
-			auto data_ptr = FlatVector::GetData<float>(out_vec);
-			auto &validity = FlatVector::Validity(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				if (products[i].price) {
-					data_ptr[i] = *products[i].price;
-				} else {
-					validity.SetInvalid(i);
-				}
-			}
-			break;
+		names.push_back(product_names[column]);
+		return_types.push_back(product_types[column]);
+	}
+	return bind_data;
+}
+
+struct ProductLookupGlobalState : GlobalTableFunctionState {
+	const cbt::Filter filter;
+	cbt::Table table;
+	ScanProfiles profiles;
+
+	ProductLookupGlobalState(const BigtableConfig &config, const vector<column_t> &product_columns)
+	    : filter(make_filter(product_columns)), table(config.MakeTable()), profiles(config) {};
+};
+
+unique_ptr<GlobalTableFunctionState> ProductLookupInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<ProductLookupFunctionData>();
+	return make_uniq<ProductLookupGlobalState>(bind_data.config, bind_data.product_columns);
+}
+
+using ProductWeek = std::array<std::optional<Product>, 7>;
+using RowFuture = google::cloud::future<google::cloud::StatusOr<std::pair<bool, cbt::Row>>>;
+
+// The row key of a lookup and the product it belongs to
+struct LookupKey {
+	string row_key;
+	uint64_t pe_id;
+	uint32_t shop_id;
+};
+
+// An input chunk of lookups, whose product rows are read asynchronously while the next chunks are batched
+struct LookupBatch {
+	unique_ptr<DataChunk> input;
+	// Row key of each input row, DConstants::INVALID_INDEX when one of its keys is NULL
+	vector<idx_t> key_idx;
+	// Days of the week looked up by each input row, one bit per ISO weekday
+	vector<uint8_t> days;
+	vector<LookupKey> keys;
+	// Single-row read of each key, completed by the client library's background threads
+	vector<RowFuture> reads;
+	vector<ProductWeek> weeks;
+	bool read = false;
+	// Next input row and day to emit
+	idx_t row_idx = 0;
+	idx_t day_idx = 0;
+};
+
+struct ProductLookupLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	// Tables are not safe to share between threads, copies share the underlying connection
+	cbt::Table table;
+	DataChunk key_chunk;
+	std::deque<LookupBatch> inflight;
+	// Whether the current input chunk was batched, as it is passed again until the function asks for more input
+	bool input_batched = false;
+
+	ProductLookupLocalState(ScanProfile &profile_p, cbt::Table table_p)
+	    : profile(profile_p), table(std::move(table_p)) {};
+};
+
+unique_ptr<LocalTableFunctionState> ProductLookupInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                           GlobalTableFunctionState *global_state) {
+	auto &bind_data = input.bind_data->Cast<ProductLookupFunctionData>();
+	auto &gstate = global_state->Cast<ProductLookupGlobalState>();
+	auto local_state = make_uniq<ProductLookupLocalState>(gstate.profiles.Register(), gstate.table);
+	local_state->key_chunk.Initialize(Allocator::Get(context.client),
+	                                  {LogicalType::UBIGINT, LogicalType::UINTEGER,
+	                                   bind_data.by_week ? LogicalType::INTEGER : LogicalType::DATE});
+	return std::move(local_state);
+}
+
+// Waits for the reads of a batch and folds each row into the week of its key. The reads were sent when the batch was
+// made, so by the time the oldest batch is emitted they have mostly completed.
+static void ReadWeeks(ProductLookupLocalState &local_state, LookupBatch &batch) {
+	auto &profile = local_state.profile;
+	batch.weeks.resize(batch.keys.size());
+	for (idx_t i = 0; i < batch.keys.size(); i++) {
+		google::cloud::StatusOr<std::pair<bool, cbt::Row>> result;
+		{
+			ProfileTimer timer(profile.stream_ns);
+			result = batch.reads[i].get();
 		}
-		case ProductColumn::BASE_PRICE: {
-			auto data_ptr = FlatVector::GetData<float>(out_vec);
-			auto &validity = FlatVector::Validity(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				if (products[i].base_price) {
-					data_ptr[i] = *products[i].base_price;
-				} else {
-					validity.SetInvalid(i);
-				}
-			}
-			break;
+		if (!result) {
+			throw std::runtime_error(result.status().message());
 		}
-		case ProductColumn::UNIT_PRICE: {
-			auto data_ptr = FlatVector::GetData<float>(out_vec);
-			auto &validity = FlatVector::Validity(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				if (products[i].unit_price) {
-					data_ptr[i] = *products[i].unit_price;
-				} else {
-					validity.SetInvalid(i);
-				}
-			}
-			break;
+		if (!result->first) {
+			continue;
 		}
-		case ProductColumn::PROMO_ID: {
-			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
-			auto &validity = FlatVector::Validity(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				if (products[i].promo_id) {
-					data_ptr[i] = *products[i].promo_id;
-				} else {
-					validity.SetInvalid(i);
-				}
-			}
-			break;
+
+		ProfileTimer timer(profile.decode_ns);
+		const auto &row = result->second;
+		ScanProfile::Add(profile.rows, 1);
+		ScanProfile::Add(profile.cells, row.cells().size());
+		ScanProfile::Add(profile.bytes, RowBytes(row));
+		const auto &key = batch.keys[i];
+		DecodeWeek(key.pe_id, key.shop_id, row, batch.weeks[i]);
+	}
+	batch.reads.clear();
+	batch.read = true;
+}
+
+static void BatchLookups(ExecutionContext &context, const ProductLookupFunctionData &bind_data,
+                         const ProductLookupGlobalState &global_state, ProductLookupLocalState &local_state,
+                         DataChunk &input) {
+	const idx_t count = input.size();
+	auto &key_chunk = local_state.key_chunk;
+	key_chunk.Reset();
+	const idx_t input_idx[] = {bind_data.pe_id_idx, bind_data.shop_id_idx, bind_data.when_idx};
+	UnifiedVectorFormat formats[3];
+	for (idx_t col = 0; col < 3; col++) {
+		VectorOperations::Cast(context.client, input.data[input_idx[col]], key_chunk.data[col], count);
+		key_chunk.data[col].ToUnifiedFormat(count, formats[col]);
+	}
+	const auto *pe_ids = UnifiedVectorFormat::GetData<uint64_t>(formats[0]);
+	const auto *shop_ids = UnifiedVectorFormat::GetData<uint32_t>(formats[1]);
+
+	LookupBatch batch;
+	batch.input = make_uniq<DataChunk>();
+	batch.input->Initialize(Allocator::Get(context.client), input.GetTypes());
+	input.Copy(*batch.input);
+	batch.key_idx.resize(count, DConstants::INVALID_INDEX);
+	batch.days.resize(count, 0);
+
+	// Hits of a search repeat the same product many times, each row key is read once per batch
+	vector<LookupKey> keys;
+	unordered_map<string, idx_t> key_idx;
+	for (idx_t i = 0; i < count; i++) {
+		const auto pe_idx = formats[0].sel->get_index(i);
+		const auto shop_idx = formats[1].sel->get_index(i);
+		const auto when_idx = formats[2].sel->get_index(i);
+		if (!formats[0].validity.RowIsValid(pe_idx) || !formats[1].validity.RowIsValid(shop_idx) ||
+		    !formats[2].validity.RowIsValid(when_idx)) {
+			continue;
 		}
-		case ProductColumn::PROMO_TEXT: {
-			auto *data_ptr = FlatVector::GetData<string_t>(out_vec);
-			auto &validity = FlatVector::Validity(out_vec);
-			for (idx_t i = 0; i < count; i++) {
-				if (products[i].promo_text) {
-					data_ptr[i] = StringVector::AddString(out_vec, *products[i].promo_text);
-				} else {
-					validity.SetInvalid(i);
-				}
-			}
-			break;
+
+		int32_t week;
+		if (bind_data.by_week) {
+			week = UnifiedVectorFormat::GetData<int32_t>(formats[2])[when_idx];
+			batch.days[i] = 0x7F;
+		} else {
+			const auto date = UnifiedVectorFormat::GetData<date_t>(formats[2])[when_idx];
+			week = WeekKey(date);
+			batch.days[i] = static_cast<uint8_t>(1 << (Date::ExtractISODayOfTheWeek(date) - 1));
 		}
-		case ProductColumn::SHELF_ID: {
-			auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
-			idx_t total = 0;
-			for (idx_t i = 0; i < count; i++) total += products[i].shelf.size();
-			ListVector::Reserve(out_vec, total);
-			auto &child = ListVector::GetEntry(out_vec);
-			auto *child_data = FlatVector::GetData<string_t>(child);
-			idx_t offset = 0;
-			for (idx_t i = 0; i < count; i++) {
-				list_data[i] = {offset, products[i].shelf.size()};
-				for (const auto &s : products[i].shelf) {
-					child_data[offset++] = StringVector::AddString(child, s);
-				}
-			}
-			ListVector::SetListSize(out_vec, total);
-			break;
+
+		auto row_key = MakeRowKey(pe_ids[pe_idx], week, shop_ids[shop_idx]);
+		const auto entry = key_idx.emplace(row_key, keys.size());
+		if (entry.second) {
+			keys.push_back(LookupKey {std::move(row_key), pe_ids[pe_idx], shop_ids[shop_idx]});
 		}
-		case ProductColumn::POSITION: {
-			auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
-			idx_t total = 0;
-			for (idx_t i = 0; i < count; i++) total += products[i].position.size();
-			ListVector::Reserve(out_vec, total);
-			auto *child_data = FlatVector::GetData<uint16_t>(ListVector::GetEntry(out_vec));
-			idx_t offset = 0;
-			for (idx_t i = 0; i < count; i++) {
-				list_data[i] = {offset, products[i].position.size()};
-				for (const auto p : products[i].position) {
-					child_data[offset++] = p;
-				}
-			}
-			ListVector::SetListSize(out_vec, total);
-			break;
+		batch.key_idx[i] = entry.first->second;
+	}
+
+	// Reads are sent right away and complete in the background, the batch only waits for them once it is emitted
+	auto &metrics = BigtableMetrics::Get();
+	batch.reads.reserve(keys.size());
+	for (const auto &key : keys) {
+		ScanProfile::Add(local_state.profile.rpcs, 1);
+		ScanProfile::Add(local_state.profile.point_reads, 1);
+		metrics.point_reads.fetch_add(1, std::memory_order_relaxed);
+		batch.reads.push_back(local_state.table.AsyncReadRow(key.row_key, global_state.filter,
+		                                                     local_state.profile.call_options));
+	}
+	batch.keys = std::move(keys);
+	local_state.inflight.push_back(std::move(batch));
+}
+
+// Emits the looked up rows of the oldest batches until the output is full or only `keep_inflight` batches are left
+static void EmitLookups(const ProductLookupFunctionData &bind_data, ProductLookupLocalState &local_state,
+                        DataChunk &output, idx_t keep_inflight) {
+	vector<const Product *> products;
+	products.reserve(STANDARD_VECTOR_SIZE);
+	SelectionVector sel(STANDARD_VECTOR_SIZE);
+
+	while (local_state.inflight.size() > keep_inflight && products.size() < STANDARD_VECTOR_SIZE) {
+		auto &batch = local_state.inflight.front();
+		if (!batch.read) {
+			ReadWeeks(local_state, batch);
 		}
-		case ProductColumn::IS_PAID: {
-			auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
-			idx_t total = 0;
-			for (idx_t i = 0; i < count; i++) total += products[i].is_paid.size();
-			ListVector::Reserve(out_vec, total);
-			auto *child_data = FlatVector::GetData<bool>(ListVector::GetEntry(out_vec));
-			idx_t offset = 0;
-			for (idx_t i = 0; i < count; i++) {
-				list_data[i] = {offset, products[i].is_paid.size()};
-				for (idx_t j = 0; j < products[i].is_paid.size(); j++) {
-					child_data[offset++] = products[i].is_paid[j];
+
+		ProfileTimer emit_timer(local_state.profile.emit_ns);
+		const idx_t offset = products.size();
+		idx_t sel_count = 0;
+		for (; batch.row_idx < batch.input->size(); batch.row_idx++, batch.day_idx = 0) {
+			const auto key_idx = batch.key_idx[batch.row_idx];
+			if (key_idx == DConstants::INVALID_INDEX) {
+				continue;
+			}
+			const auto &week = batch.weeks[key_idx];
+			for (; batch.day_idx < 7; batch.day_idx++) {
+				if (!(batch.days[batch.row_idx] & (1 << batch.day_idx)) || !week[batch.day_idx]) {
+					continue;
 				}
+				if (products.size() == STANDARD_VECTOR_SIZE) {
+					break;
+				}
+				sel.set_index(sel_count++, batch.row_idx);
+				products.push_back(&*week[batch.day_idx]);
 			}
-			ListVector::SetListSize(out_vec, total);
-			break;
+			if (batch.day_idx < 7) {
+				break;
+			}
+		}
+
+		for (idx_t col = 0; col < bind_data.input_columns; col++) {
+			VectorOperations::Copy(batch.input->data[col], output.data[col], sel, sel_count, 0, offset);
 		}
+		if (batch.row_idx == batch.input->size()) {
+			local_state.inflight.pop_front();
 		}
 	}
 
-	local_state.remainder_idx += count;
-	output.SetCardinality(count);
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
+	for (idx_t i = 0; i < bind_data.product_columns.size(); i++) {
+		WriteProductColumn(static_cast<ProductColumn>(bind_data.product_columns[i]),
+		                   output.data[bind_data.input_columns + i], products.size(),
+		                   [&](idx_t row) -> const Product & { return *products[row]; });
+	}
+	output.SetCardinality(products.size());
 }
 
-double ProductScanProgress(ClientContext &context, const FunctionData *bind_data,
-                           const GlobalTableFunctionState *global_state) {
-	const auto &gstate = global_state->Cast<ProductGlobalState>();
-	const auto total_count = gstate.ranges.size();
-	if (total_count == 0) {
-		return 100.0;
+OperatorResultType ProductLookupFunction(ExecutionContext &context, TableFunctionInput &data, DataChunk &input,
+                                         DataChunk &output) {
+	const auto &bind_data = data.bind_data->Cast<ProductLookupFunctionData>();
+	const auto &global_state = data.global_state->Cast<ProductLookupGlobalState>();
+	auto &local_state = data.local_state->Cast<ProductLookupLocalState>();
+
+	if (!local_state.input_batched) {
+		BatchLookups(context, bind_data, global_state, local_state, input);
+		local_state.input_batched = true;
+	}
+
+	// Up to max_inflight batches have reads in flight, the oldest is emitted once the window is full
+	EmitLookups(bind_data, local_state, output, bind_data.max_inflight - 1);
+	if (local_state.inflight.size() < bind_data.max_inflight) {
+		local_state.input_batched = false;
+		return OperatorResultType::NEED_MORE_INPUT;
+	}
+	return OperatorResultType::HAVE_MORE_OUTPUT;
+}
+
+OperatorFinalizeResultType ProductLookupFunctionFinal(ExecutionContext &context, TableFunctionInput &data,
+                                                      DataChunk &output) {
+	const auto &bind_data = data.bind_data->Cast<ProductLookupFunctionData>();
+	auto &local_state = data.local_state->Cast<ProductLookupLocalState>();
+
+	EmitLookups(bind_data, local_state, output, 0);
+	return local_state.inflight.empty() ? OperatorFinalizeResultType::FINISHED
+	                                    : OperatorFinalizeResultType::HAVE_MORE_OUTPUT;
+}
+
+unique_ptr<NodeStatistics> ProductCardinality(ClientContext &context, const FunctionData *bind_data) {
+	const auto &data = bind_data->Cast<ProductFunctionData>();
+	const auto range_weeks = data.ranges.size() * data.range_weeks;
+	const auto rows_per_range_week = data.estimate->RowsPerRangeWeek();
+	if (data.shop_ids.empty()) {
+		// A span covers every shop, so nothing bounds its rows until a scan of the table has completed
+		if (!rows_per_range_week) {
+			return nullptr;
+		}
+		return make_uniq<NodeStatistics>(static_cast<idx_t>(*rows_per_range_week * static_cast<double>(range_weeks)));
 	}
-	const auto completed = static_cast<double>(gstate.ranges_idx);
-	return (100.0 * completed) / static_cast<double>(total_count);
+	// A point range holds at most one row per day of its week
+	const auto max_rows = range_weeks * 7;
+	const auto rows = rows_per_range_week ? static_cast<idx_t>(*rows_per_range_week * static_cast<double>(range_weeks))
+	                                      : max_rows;
+	return make_uniq<NodeStatistics>(MinValue(rows, max_rows), max_rows);
 }
 
 unique_ptr<BaseStatistics> ProductStatistics(ClientContext &context, const FunctionData *bind_data,
@@ -423,6 +813,12 @@ unique_ptr<BaseStatistics> ProductStatistics(ClientContext &context, const Funct
 	case ProductColumn::DATE: {
 		auto stats = BaseStatistics::CreateUnknown(LogicalType::DATE);
 		stats.SetHasNoNullFast();
+		// Point ranges only read the row of the first week
+		const auto last_week = data.shop_ids.empty() ? data.week_end : data.week_start;
+		if (WeekCount(data.week_start, last_week) > 0) {
+			NumericStats::SetMin(stats, Value::DATE(WeekStart(data.week_start)));
+			NumericStats::SetMax(stats, Value::DATE(WeekStart(last_week) + 6));
+		}
 		return make_uniq<BaseStatistics>(std::move(stats));
 	}
 	case ProductColumn::SHELF_ID: {
@@ -0,0 +1,320 @@
+#include "product_agg.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "keys.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "utils.hpp"
+
+#include <bit>
+#include <google/cloud/bigtable/table.h>
+#include <optional>
+#include <string_view>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+enum ProductAggColumn : column_t {
+	PE_ID = 0,
+	WEEK = 1,
+	SHOPS = 2,
+	PRICED_DAYS = 3,
+	MIN_PRICE = 4,
+	MAX_PRICE = 5,
+	AVG_PRICE = 6,
+	PROMO_DAYS = 7
+};
+
+// The rollup of the product-days of a pe_id and week over the shops with a price or a promo that week
+struct PriceRollup {
+	uint64_t pe_id;
+	int32_t week;
+	uint32_t shops = 0;
+	uint64_t priced_days = 0;
+	uint64_t promo_days = 0;
+	float min_price = NumericLimits<float>::Maximum();
+	float max_price = NumericLimits<float>::Minimum();
+	double price_sum = 0;
+};
+
+struct ProductAggFunctionData : TableFunctionData {
+	BigtableConfig config;
+	vector<uint64_t> pe_ids;
+	vector<cbt::RowRange> ranges;
+	// Ranges of one pe_id, read by the same thread so that its weeks are rolled up without merging
+	idx_t ranges_per_pe_id;
+};
+
+static cbt::Filter make_filter();
+
+unique_ptr<FunctionData> ProductAggFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"pe_id", "week", "shops", "priced_days", "min_price", "max_price", "avg_price", "promo_days"};
+	return_types = {LogicalType::UBIGINT, LogicalType::INTEGER, LogicalType::UINTEGER, LogicalType::UBIGINT,
+	                LogicalType::FLOAT,   LogicalType::FLOAT,   LogicalType::DOUBLE,   LogicalType::UBIGINT};
+
+	auto bind_data = make_uniq<ProductAggFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "product"));
+	const auto week_start = std::to_string(IntegerValue::Get(input.inputs[0]));
+	const auto week_end = std::to_string(IntegerValue::Get(input.inputs[1]));
+	const auto &ls_pe_id = ListValue::GetChildren(input.inputs[2]);
+
+	vector<string> prefix_ids;
+	prefix_ids.reserve(ls_pe_id.size());
+	bind_data->pe_ids.reserve(ls_pe_id.size());
+	for (const auto &p : ls_pe_id) {
+		const auto pe_id = BigIntValue::Get(p);
+		bind_data->pe_ids.emplace_back(pe_id);
+		prefix_ids.emplace_back(ReverseId(pe_id));
+	}
+
+	// Unlike product, ranges of given shops are laid out pe_id by pe_id, each covering every shop in order
+	if (input.inputs.size() == 4) {
+		const auto &ls_shop_id = ListValue::GetChildren(input.inputs[3]);
+		bind_data->ranges_per_pe_id = ls_shop_id.size();
+		bind_data->ranges.reserve(prefix_ids.size() * ls_shop_id.size());
+		for (const auto &p : prefix_ids) {
+			for (const auto &s : ls_shop_id) {
+				const auto row_key = p + "/" + week_start + "/" + std::to_string(IntegerValue::Get(s));
+				bind_data->ranges.emplace_back(cbt::RowRange::Closed(row_key, row_key));
+			}
+		}
+	} else {
+		bind_data->ranges_per_pe_id = 1;
+		bind_data->ranges.reserve(prefix_ids.size());
+		for (const auto &p : prefix_ids) {
+			bind_data->ranges.emplace_back(cbt::RowRange::Closed(p + "/" + week_start + "/", p + "/" + week_end + "0"));
+		}
+	}
+
+	return bind_data;
+}
+
+struct ProductAggGlobalState : GlobalTableFunctionState {
+	const cbt::Filter filter;
+	RangeReader reader;
+
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
+	const vector<uint64_t> pe_ids;
+	const vector<column_t> column_ids;
+	ScanProfiles profiles;
+
+	ProductAggGlobalState(const BigtableConfig &config, vector<uint64_t> pe_ids_p, vector<cbt::RowRange> ranges_p,
+	                      idx_t ranges_per_pe_id, vector<column_t> column_ids_p)
+	    : filter(make_filter()), reader(config), scheduler(std::move(ranges_p), ranges_per_pe_id),
+	      max_inflight(config.max_inflight), pe_ids(std::move(pe_ids_p)), column_ids(std::move(column_ids_p)),
+	      profiles(config) {};
+
+	idx_t MaxThreads() const override {
+		return MinValue(scheduler.MaxThreads(), max_inflight);
+	}
+};
+
+unique_ptr<GlobalTableFunctionState> ProductAggInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<ProductAggFunctionData>();
+	return make_uniq<ProductAggGlobalState>(bind_data.config, std::move(bind_data.pe_ids),
+	                                        std::move(bind_data.ranges), bind_data.ranges_per_pe_id,
+	                                        std::move(input.column_ids));
+}
+
+struct ProductAggLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	idx_t remainder_idx = 0;
+	vector<PriceRollup> remainder;
+
+	explicit ProductAggLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> ProductAggInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                        GlobalTableFunctionState *global_state) {
+	return make_uniq<ProductAggLocalState>(global_state->Cast<ProductAggGlobalState>().profiles.Register());
+}
+
+// Rolls the rows of a pe_id up week by week. Rows of a range come week by week, and the ranges of given shops all
+// read the same week, so a week is complete once a row of another week or the end of the pe_id is reached.
+static void RollUpPeId(ProductAggGlobalState &global_state, ProductAggLocalState &local_state, idx_t first_range) {
+	const auto pe_id = global_state.pe_ids[first_range / global_state.scheduler.group_size];
+	std::optional<PriceRollup> rollup;
+
+	for (idx_t range_idx = first_range; range_idx < global_state.scheduler.GroupEnd(first_range); range_idx++) {
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			std::string_view row_key = row.row_key();
+			const auto week_begin = row_key.find('/') + 1;
+			const auto week_opt = ParseInt32(row_key.substr(week_begin, row_key.find('/', week_begin) - week_begin));
+			if (!week_opt) {
+				ScanProfile::Add(local_state.profile.filtered, 1);
+				return;
+			}
+
+			if (rollup && rollup->week != *week_opt) {
+				local_state.remainder.emplace_back(*rollup);
+				rollup.reset();
+			}
+			if (!rollup) {
+				rollup.emplace();
+				rollup->pe_id = pe_id;
+				rollup->week = *week_opt;
+			}
+
+			// Like product, the last price cell of a day wins
+			std::array<std::optional<float>, 7> prices;
+			uint8_t promo_days = 0;
+			for (const auto &cell : row.cells()) {
+				const date_t date = Date::EpochToDate(cell.timestamp().count() / 1'000'000);
+				const int32_t weekday = Date::ExtractISODayOfTheWeek(date) - 1;
+				switch (cell.family_name()[0]) {
+				case 'p':
+					if (cell.column_qualifier() == "p") {
+						prices[weekday] = ParseFloat(cell.value());
+					}
+					break;
+				case 'd':
+					promo_days |= 1 << weekday;
+					break;
+				}
+			}
+
+			rollup->shops++;
+			rollup->promo_days += std::popcount(promo_days);
+			for (const auto &price : prices) {
+				if (price) {
+					rollup->priced_days++;
+					rollup->min_price = MinValue(rollup->min_price, *price);
+					rollup->max_price = MaxValue(rollup->max_price, *price);
+					rollup->price_sum += *price;
+				}
+			}
+		});
+	}
+
+	if (rollup) {
+		local_state.remainder.emplace_back(*rollup);
+	}
+}
+
+void ProductAggFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<ProductAggGlobalState>();
+	auto &local_state = data.local_state->Cast<ProductAggLocalState>();
+
+	if (local_state.remainder_idx == local_state.remainder.size()) {
+		local_state.remainder_idx = 0;
+		local_state.remainder.clear();
+	}
+	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+		RollUpPeId(global_state, local_state, range_idx);
+	}
+
+	const idx_t count =
+	    MinValue<idx_t>(STANDARD_VECTOR_SIZE, local_state.remainder.size() - local_state.remainder_idx);
+	if (count == 0) {
+		output.SetCardinality(0);
+		return;
+	}
+
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
+	const auto *rollups = &local_state.remainder[local_state.remainder_idx];
+
+	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+		auto &out_vec = output.data[col_idx];
+
+		switch (static_cast<ProductAggColumn>(global_state.column_ids[col_idx])) {
+		case ProductAggColumn::PE_ID: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].pe_id;
+			}
+			break;
+		}
+		case ProductAggColumn::WEEK: {
+			auto data_ptr = FlatVector::GetData<int32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].week;
+			}
+			break;
+		}
+		case ProductAggColumn::SHOPS: {
+			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].shops;
+			}
+			break;
+		}
+		case ProductAggColumn::PRICED_DAYS: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].priced_days;
+			}
+			break;
+		}
+		case ProductAggColumn::MIN_PRICE:
+		case ProductAggColumn::MAX_PRICE: {
+			const bool min = global_state.column_ids[col_idx] == ProductAggColumn::MIN_PRICE;
+			auto data_ptr = FlatVector::GetData<float>(out_vec);
+			auto &validity = FlatVector::Validity(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				if (rollups[i].priced_days > 0) {
+					data_ptr[i] = min ? rollups[i].min_price : rollups[i].max_price;
+				} else {
+					validity.SetInvalid(i);
+				}
+			}
+			break;
+		}
+		case ProductAggColumn::AVG_PRICE: {
+			auto data_ptr = FlatVector::GetData<double>(out_vec);
+			auto &validity = FlatVector::Validity(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				if (rollups[i].priced_days > 0) {
+					data_ptr[i] = rollups[i].price_sum / static_cast<double>(rollups[i].priced_days);
+				} else {
+					validity.SetInvalid(i);
+				}
+			}
+			break;
+		}
+		case ProductAggColumn::PROMO_DAYS: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].promo_days;
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	local_state.remainder_idx += count;
+	output.SetCardinality(count);
+}
+
+double ProductAggScanProgress(ClientContext &context, const FunctionData *bind_data,
+                              const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<ProductAggGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> ProductAggDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<ProductAggGlobalState>().profiles.ToMap();
+}
+
+// Only the price qualifier and the promo family without its values are read. The promo family is read even when
+// promo_days is not projected, so that a shop with only a promo counts in shops whatever the projection.
+inline static cbt::Filter make_filter() {
+	return cbt::Filter::Interleave(
+	    cbt::Filter::Chain(cbt::Filter::FamilyRegex("p"), cbt::Filter::ColumnRegex("p")),
+	    cbt::Filter::Chain(cbt::Filter::FamilyRegex("d"), cbt::Filter::StripValueTransformer()));
+}
+
+} // namespace duckdb
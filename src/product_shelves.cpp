@@ -0,0 +1,318 @@
+#include "product_shelves.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "filters.hpp"
+#include "keys.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "sampling.hpp"
+#include "utils.hpp"
+
+#include <google/cloud/bigtable/table.h>
+#include <string_view>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+enum ShelvesColumn : column_t { PE_ID = 0, SHOP_ID = 1, DATE = 2, SHELF_ID = 3, POSITION = 4, IS_PAID = 5 };
+
+// One placement of a product on a shelf, a cell of the s (organic) or S (paid) family
+struct Shelf {
+	uint64_t pe_id;
+	uint32_t shop_id;
+	date_t date;
+	string shelf_id;
+	uint16_t position;
+	bool is_paid;
+};
+
+struct ShelvesFunctionData : TableFunctionData {
+	BigtableConfig config;
+	vector<uint64_t> pe_ids;
+	vector<cbt::RowRange> ranges;
+};
+
+static vector<LogicalType> ShelvesTypes() {
+	return {LogicalType::UBIGINT, LogicalType::UINTEGER,  LogicalType::DATE,
+	        LogicalType::VARCHAR, LogicalType::USMALLINT, LogicalType::BOOLEAN};
+}
+
+unique_ptr<FunctionData> ProductShelvesFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                    vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"pe_id", "shop_id", "date", "shelf_id", "position", "is_paid"};
+	return_types = ShelvesTypes();
+
+	auto bind_data = make_uniq<ShelvesFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "product"));
+	const auto week_start = std::to_string(IntegerValue::Get(input.inputs[0]));
+	const auto week_end = std::to_string(IntegerValue::Get(input.inputs[1]));
+	const auto &ls_pe_id = ListValue::GetChildren(input.inputs[2]);
+
+	vector<string> prefix_ids;
+	prefix_ids.reserve(ls_pe_id.size());
+	bind_data->pe_ids.reserve(ls_pe_id.size());
+	for (const auto &p : ls_pe_id) {
+		const auto pe_id = BigIntValue::Get(p);
+		bind_data->pe_ids.emplace_back(pe_id);
+		prefix_ids.emplace_back(ReverseId(pe_id));
+	}
+
+	// Ranges are laid out like those of product, shop by shop when shops are given
+	if (input.inputs.size() == 4) {
+		const auto &ls_shop_id = ListValue::GetChildren(input.inputs[3]);
+		bind_data->ranges.reserve(prefix_ids.size() * ls_shop_id.size());
+		for (const auto &s : ls_shop_id) {
+			const auto shop_id = std::to_string(IntegerValue::Get(s));
+			for (const auto &p : prefix_ids) {
+				const auto row_key = p + "/" + week_start + "/" + shop_id;
+				bind_data->ranges.emplace_back(cbt::RowRange::Closed(row_key, row_key));
+			}
+		}
+	} else {
+		bind_data->ranges.reserve(prefix_ids.size());
+		for (const auto &p : prefix_ids) {
+			bind_data->ranges.emplace_back(cbt::RowRange::Closed(p + "/" + week_start + "/", p + "/" + week_end + "0"));
+		}
+	}
+
+	return bind_data;
+}
+
+// Only the shelf families are read. Equality on is_paid narrows them to one family, equality on shelf_id selects
+// its qualifier and date bounds become a timestamp range; every pushed filter is still evaluated on the output.
+static cbt::Filter MakeShelvesFilter(optional_ptr<TableFilterSet> table_filters, const vector<column_t> &column_ids) {
+	string families = "s|S";
+	vector<cbt::Filter> filters;
+
+	if (table_filters) {
+		for (const auto &entry : table_filters->filters) {
+			const auto bounds = GetFilterBounds(*entry.second);
+			switch (static_cast<ShelvesColumn>(column_ids[entry.first])) {
+			case ShelvesColumn::IS_PAID:
+				if (bounds.IsEquality()) {
+					families = BooleanValue::Get(bounds.lower) ? "S" : "s";
+				}
+				break;
+			case ShelvesColumn::SHELF_ID:
+				if (bounds.IsEquality()) {
+					filters.emplace_back(cbt::Filter::ColumnRegex(EscapeRegex(StringValue::Get(bounds.lower))));
+				}
+				break;
+			case ShelvesColumn::DATE: {
+				int64_t start = 0;
+				int64_t end = 0;
+				if (!bounds.lower.IsNull()) {
+					const auto date = DateValue::Get(bounds.lower) + (bounds.lower_inclusive ? 0 : 1);
+					start = MaxValue<int64_t>(Date::Epoch(date) * 1'000'000, 0);
+				}
+				if (!bounds.upper.IsNull()) {
+					const auto date = DateValue::Get(bounds.upper) + (bounds.upper_inclusive ? 1 : 0);
+					end = MaxValue<int64_t>(Date::Epoch(date) * 1'000'000, 0);
+				}
+				if (start > 0 || end > 0) {
+					filters.emplace_back(cbt::Filter::TimestampRangeMicros(start, end));
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+	}
+
+	filters.insert(filters.begin(), cbt::Filter::FamilyRegex(families));
+	if (filters.size() == 1) {
+		return std::move(filters[0]);
+	}
+	return cbt::Filter::ChainFromRange(filters.begin(), filters.end());
+}
+
+struct ShelvesGlobalState : GlobalTableFunctionState {
+	const cbt::Filter filter;
+	RangeReader reader;
+
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
+	const vector<uint64_t> pe_ids;
+	const vector<column_t> column_ids;
+	const unique_ptr<Expression> filter_expression;
+	ScanProfiles profiles;
+
+	ShelvesGlobalState(const BigtableConfig &config, cbt::Filter filter_p, vector<uint64_t> pe_ids_p,
+	                   vector<cbt::RowRange> ranges_p, vector<column_t> column_ids_p,
+	                   unique_ptr<Expression> filter_expression_p, ScanSample sample)
+	    : filter(sample.Apply(std::move(filter_p))), reader(config), scheduler(std::move(ranges_p), 1, sample),
+	      max_inflight(config.max_inflight), pe_ids(std::move(pe_ids_p)), column_ids(std::move(column_ids_p)),
+	      filter_expression(std::move(filter_expression_p)), profiles(config) {};
+
+	idx_t MaxThreads() const override {
+		return MinValue(scheduler.MaxThreads(), max_inflight);
+	}
+};
+
+unique_ptr<GlobalTableFunctionState> ProductShelvesInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<ShelvesFunctionData>();
+	auto filter = MakeShelvesFilter(input.filters, input.column_ids);
+	auto filter_expression = MakeFilterExpression(input.filters, input.column_ids, ShelvesTypes());
+	auto sample = ScanSample::Get(bind_data.config, input.sample_options);
+	return make_uniq<ShelvesGlobalState>(bind_data.config, std::move(filter), std::move(bind_data.pe_ids),
+	                                     std::move(bind_data.ranges), input.column_ids, std::move(filter_expression),
+	                                     sample);
+}
+
+struct ShelvesLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	idx_t remainder_idx = 0;
+	vector<Shelf> remainder;
+
+	unique_ptr<ExpressionExecutor> executor;
+	SelectionVector sel {STANDARD_VECTOR_SIZE};
+
+	explicit ShelvesLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> ProductShelvesInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                            GlobalTableFunctionState *global_state) {
+	auto &gstate = global_state->Cast<ShelvesGlobalState>();
+	auto local_state = make_uniq<ShelvesLocalState>(gstate.profiles.Register());
+	if (gstate.filter_expression) {
+		local_state->executor = make_uniq<ExpressionExecutor>(context.client, *gstate.filter_expression);
+	}
+	return std::move(local_state);
+}
+
+// Reads ranges until a chunk of placements is buffered or every range has been claimed
+static void FillRemainder(ShelvesGlobalState &global_state, ShelvesLocalState &local_state) {
+	if (local_state.remainder_idx == local_state.remainder.size()) {
+		local_state.remainder_idx = 0;
+		local_state.remainder.clear();
+	}
+
+	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+
+		const auto pe_id = global_state.pe_ids[range_idx % global_state.pe_ids.size()];
+		const auto &range = global_state.scheduler.ranges[range_idx];
+
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			std::string_view row_key = row.row_key();
+			const auto shop_id_opt = ParseUint32(row_key.substr(row_key.find_last_of('/') + 1));
+			if (!shop_id_opt) {
+				ScanProfile::Add(local_state.profile.filtered, 1);
+				return;
+			}
+
+			for (const auto &cell : row.cells()) {
+				const auto position = ParseUint16(cell.value());
+				if (!position) {
+					ScanProfile::Add(local_state.profile.filtered, 1);
+					continue;
+				}
+				local_state.remainder.push_back(Shelf {pe_id, *shop_id_opt,
+				                                       Date::EpochToDate(cell.timestamp().count() / 1'000'000),
+				                                       cell.column_qualifier(), *position, cell.family_name() == "S"});
+			}
+		});
+	}
+}
+
+void ProductShelvesFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<ShelvesGlobalState>();
+	auto &local_state = data.local_state->Cast<ShelvesLocalState>();
+
+	while (true) {
+		FillRemainder(global_state, local_state);
+		const idx_t count =
+		    MinValue<idx_t>(STANDARD_VECTOR_SIZE, local_state.remainder.size() - local_state.remainder_idx);
+		if (count == 0) {
+			output.SetCardinality(0);
+			return;
+		}
+
+		ProfileTimer emit_timer(local_state.profile.emit_ns);
+		const auto *shelves = &local_state.remainder[local_state.remainder_idx];
+
+		for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+			auto &out_vec = output.data[col_idx];
+
+			switch (static_cast<ShelvesColumn>(global_state.column_ids[col_idx])) {
+			case ShelvesColumn::PE_ID: {
+				auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = shelves[i].pe_id;
+				}
+				break;
+			}
+			case ShelvesColumn::SHOP_ID: {
+				auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = shelves[i].shop_id;
+				}
+				break;
+			}
+			case ShelvesColumn::DATE: {
+				auto data_ptr = FlatVector::GetData<date_t>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = shelves[i].date;
+				}
+				break;
+			}
+			case ShelvesColumn::SHELF_ID: {
+				auto data_ptr = FlatVector::GetData<string_t>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = StringVector::AddString(out_vec, shelves[i].shelf_id);
+				}
+				break;
+			}
+			case ShelvesColumn::POSITION: {
+				auto data_ptr = FlatVector::GetData<uint16_t>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = shelves[i].position;
+				}
+				break;
+			}
+			case ShelvesColumn::IS_PAID: {
+				auto data_ptr = FlatVector::GetData<bool>(out_vec);
+				for (idx_t i = 0; i < count; i++) {
+					data_ptr[i] = shelves[i].is_paid;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		local_state.remainder_idx += count;
+		output.SetCardinality(count);
+		if (!local_state.executor) {
+			return;
+		}
+		ScanProfile::Add(local_state.profile.filtered,
+		                 ApplyFilterExpression(*local_state.executor, local_state.sel, output));
+		if (output.size() > 0) {
+			return;
+		}
+		output.Reset();
+	}
+}
+
+double ProductShelvesScanProgress(ClientContext &context, const FunctionData *bind_data,
+                                  const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<ShelvesGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> ProductShelvesDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<ShelvesGlobalState>().profiles.ToMap();
+}
+
+} // namespace duckdb
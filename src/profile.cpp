@@ -0,0 +1,101 @@
+#include "profile.hpp"
+
+#include "concurrency.hpp"
+#include "duckdb.hpp"
+
+#include <google/cloud/bigtable/options.h>
+
+namespace duckdb {
+
+// Wraps the configured retry policy to count the retries of one scan thread.
+class CountingRetryPolicy : public cbt::DataRetryPolicy {
+public:
+	CountingRetryPolicy(std::unique_ptr<cbt::DataRetryPolicy> inner_p, atomic<uint64_t> &retries_p)
+	    : inner(std::move(inner_p)), retries(retries_p) {};
+
+	std::unique_ptr<cbt::DataRetryPolicy> clone() const override {
+		return std::make_unique<CountingRetryPolicy>(inner->clone(), retries);
+	}
+
+	bool OnFailure(const google::cloud::Status &status) override {
+		const auto retry = inner->OnFailure(status);
+		if (retry) {
+			retries.fetch_add(1, std::memory_order_relaxed);
+		}
+		return retry;
+	}
+
+	bool IsExhausted() const override {
+		return inner->IsExhausted();
+	}
+
+	bool IsPermanentFailure(const google::cloud::Status &status) const override {
+		return inner->IsPermanentFailure(status);
+	}
+
+private:
+	std::unique_ptr<cbt::DataRetryPolicy> inner;
+	atomic<uint64_t> &retries;
+};
+
+ScanProfile &ScanProfiles::Register() {
+	auto profile = make_uniq<ScanProfile>();
+	profile->call_options.set<cbt::DataRetryPolicyOption>(
+	    std::make_shared<CountingRetryPolicy>(config.MakeRetryPolicy(), profile->retries));
+
+	lock_guard<mutex> guard(lock);
+	profiles.emplace_back(std::move(profile));
+	return *profiles.back();
+}
+
+static string FormatMillis(uint64_t nanos) {
+	return StringUtil::Format("%.3fms", static_cast<double>(nanos) / 1e6);
+}
+
+InsertionOrderPreservingMap<string> ScanProfiles::ToMap() const {
+	uint64_t rpcs = 0, retries = 0, resumes = 0, point_reads = 0, hedges = 0, rows = 0, cells = 0, bytes = 0, filtered = 0;
+	uint64_t throttle_ns = 0, stream_ns = 0, decode_ns = 0, emit_ns = 0;
+	idx_t threads;
+	{
+		lock_guard<mutex> guard(lock);
+		threads = profiles.size();
+		for (const auto &profile : profiles) {
+			rpcs += profile->rpcs.load(std::memory_order_relaxed);
+			retries += profile->retries.load(std::memory_order_relaxed);
+			resumes += profile->resumes.load(std::memory_order_relaxed);
+			point_reads += profile->point_reads.load(std::memory_order_relaxed);
+			hedges += profile->hedges.load(std::memory_order_relaxed);
+			rows += profile->rows.load(std::memory_order_relaxed);
+			cells += profile->cells.load(std::memory_order_relaxed);
+			bytes += profile->bytes.load(std::memory_order_relaxed);
+			filtered += profile->filtered.load(std::memory_order_relaxed);
+			throttle_ns += profile->throttle_ns.load(std::memory_order_relaxed);
+			stream_ns += profile->stream_ns.load(std::memory_order_relaxed);
+			decode_ns += profile->decode_ns.load(std::memory_order_relaxed);
+			emit_ns += profile->emit_ns.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Timers are summed over threads
+	InsertionOrderPreservingMap<string> result;
+	result["Threads"] = std::to_string(threads);
+	result["RPCs"] = std::to_string(rpcs);
+	result["Retries"] = std::to_string(retries);
+	result["Resumes"] = std::to_string(resumes);
+	if (point_reads > 0) {
+		result["Point Reads"] = std::to_string(point_reads);
+		result["Hedge Rate"] = StringUtil::Format("%.2f%%", 100.0 * static_cast<double>(hedges) / point_reads);
+	}
+	result["Bigtable Rows"] = std::to_string(rows);
+	result["Cells"] = std::to_string(cells);
+	result["Bytes Received"] = StringUtil::BytesToHumanReadableString(bytes);
+	result["Filtered Client-side"] = std::to_string(filtered);
+	result["Concurrency Limit"] = StringUtil::Format("%.1f", ConcurrencyLimiter::Get(config).Limit());
+	result["Throttle Wait"] = FormatMillis(throttle_ns);
+	result["Stream Wait"] = FormatMillis(stream_ns);
+	result["Decode"] = FormatMillis(decode_ns);
+	result["Emit"] = FormatMillis(emit_ns);
+	return result;
+}
+
+} // namespace duckdb
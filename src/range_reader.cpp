@@ -0,0 +1,115 @@
+#include "range_reader.hpp"
+
+#include "duckdb.hpp"
+
+#include <condition_variable>
+
+using ::google::cloud::future;
+
+namespace duckdb {
+
+// Point reads timed before the hedging delay is trusted; until then no read is hedged
+static constexpr uint64_t HEDGE_MIN_SAMPLES = 100;
+
+// The outcome of the attempts of one point read, shared with their completion callbacks
+struct HedgeRace {
+	mutex lock;
+	std::condition_variable done;
+	std::optional<RangeReader::PointResult> result;
+	idx_t pending = 0;
+	// Whether the latency of the first attempt was recorded, by its own callback or as a lower bound once a hedge
+	// won the race and it was cancelled
+	bool first_timed = false;
+};
+
+std::optional<std::chrono::microseconds> RangeReader::HedgeDelay() const {
+	const auto &histogram = BigtableMetrics::Get().point_read_us;
+	if (histogram.Count() < HEDGE_MIN_SAMPLES) {
+		return std::nullopt;
+	}
+	return std::chrono::microseconds(histogram.Quantile(hedge_quantile));
+}
+
+RangeReader::PointResult RangeReader::ReadPoint(const std::string &row_key, const cbt::Filter &filter,
+                                                ScanProfile &profile) {
+	auto &metrics = BigtableMetrics::Get();
+	auto race = std::make_shared<HedgeRace>();
+	std::vector<future<void>> attempts;
+	const auto start = std::chrono::steady_clock::now();
+	const auto elapsed_us = [start]() {
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+	};
+	// Each call picks the next channel of the connection's pool, so a hedge does not queue behind the first attempt
+	const auto launch = [&](bool first) {
+		{
+			lock_guard<mutex> guard(race->lock);
+			race->pending++;
+		}
+		ScanProfile::Add(profile.rpcs, 1);
+		attempts.push_back(table.AsyncReadRow(row_key, filter, profile.call_options)
+		                       .then([race, first, elapsed_us, &metrics](future<PointResult> attempt) {
+			                       auto result = attempt.get();
+			                       {
+				                       lock_guard<mutex> guard(race->lock);
+				                       race->pending--;
+				                       // The delay is learned from first attempts, whether or not they were hedged
+				                       if (first && result.ok() && !race->first_timed) {
+					                       metrics.point_read_us.Record(elapsed_us());
+					                       race->first_timed = true;
+				                       }
+				                       // A failure only decides the race once no other attempt can still succeed
+				                       if (!race->result && (result.ok() || race->pending == 0)) {
+					                       race->result = std::move(result);
+				                       }
+			                       }
+			                       race->done.notify_all();
+		                       }));
+	};
+	const auto resolved = [&]() {
+		return race->result.has_value();
+	};
+
+	metrics.point_reads.fetch_add(1, std::memory_order_relaxed);
+	ScanProfile::Add(profile.point_reads, 1);
+	const auto delay = HedgeDelay();
+	launch(true);
+
+	if (delay) {
+		bool hedge;
+		{
+			std::unique_lock<mutex> guard(race->lock);
+			hedge = !race->done.wait_for(guard, *delay, resolved);
+		}
+		// Hedges are capped to a share of all point reads so that a slow instance is not sent twice the load
+		const auto hedges = metrics.hedges.load(std::memory_order_relaxed);
+		const auto point_reads = metrics.point_reads.load(std::memory_order_relaxed);
+		if (hedge && static_cast<double>(hedges) < hedge_budget * static_cast<double>(point_reads)) {
+			metrics.hedges.fetch_add(1, std::memory_order_relaxed);
+			ScanProfile::Add(profile.hedges, 1);
+			launch(false);
+		}
+	}
+
+	std::unique_lock<mutex> guard(race->lock);
+	race->done.wait(guard, resolved);
+	auto result = std::move(*race->result);
+	// A first attempt still running when a hedge won is about to be cancelled. It took at least as long as the race,
+	// which is recorded in its place: leaving out the slow first attempts would pull the delay down and send ever
+	// more hedges.
+	if (result.ok() && !race->first_timed) {
+		metrics.point_read_us.Record(elapsed_us());
+		race->first_timed = true;
+	}
+	guard.unlock();
+	for (auto &attempt : attempts) {
+		attempt.cancel();
+	}
+
+	if (result.ok()) {
+		metrics.point_race_us.Record(elapsed_us());
+	}
+	return result;
+}
+
+} // namespace duckdb
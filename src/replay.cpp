@@ -0,0 +1,306 @@
+#include "replay.hpp"
+
+#include "duckdb.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <google/cloud/bigtable/mocks/mock_row_reader.h>
+#include <sstream>
+#include <thread>
+
+using ::google::cloud::future;
+using ::google::cloud::Options;
+using ::google::cloud::Status;
+using ::google::cloud::StatusCode;
+using ::google::cloud::StatusOr;
+namespace cbt = ::google::cloud::bigtable;
+namespace cbtm = ::google::cloud::bigtable_mocks;
+
+namespace duckdb {
+
+// A record file starts with this magic, followed by one entry per ReadRows call:
+//   request key, row count, then per row its key, cell count and per cell family, qualifier, timestamp, value.
+// Strings are prefixed by their uint32_t length, counts are uint32_t and timestamps int64_t microseconds.
+static constexpr std::string_view RECORD_MAGIC = "BTREC1\n";
+
+// Identifies a request by everything that determines its rows, leaving out the app profile.
+static string RequestKey(const cbt::ReadRowsParams &params) {
+	string key = params.table_name;
+	key += '\0';
+	key += params.row_set.as_proto().SerializeAsString();
+	key += '\0';
+	key += params.filter.as_proto().SerializeAsString();
+	key += '\0';
+	key += std::to_string(params.rows_limit);
+	key += params.reverse ? "r" : "f";
+	return key;
+}
+
+// Single-row reads are keyed like the one-row ReadRows request the client library sends for them.
+static string RequestKey(const std::string &table_name, const std::string &row_key, const cbt::Filter &filter) {
+	return RequestKey(cbt::ReadRowsParams {table_name, "", cbt::RowSet(row_key), 1, filter});
+}
+
+static void WriteUint32(string &buffer, uint32_t value) {
+	buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static void WriteString(string &buffer, std::string_view value) {
+	WriteUint32(buffer, static_cast<uint32_t>(value.size()));
+	buffer.append(value);
+}
+
+class RecordReader {
+public:
+	RecordReader(const string &data, const string &path)
+	    : pos(data.data()), end(data.data() + data.size()), path(path) {};
+
+	bool AtEnd() const {
+		return pos == end;
+	}
+
+	template <class T>
+	T Read() {
+		T value;
+		Check(sizeof(T));
+		memcpy(&value, pos, sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+
+	void Skip(idx_t size) {
+		Check(size);
+		pos += size;
+	}
+
+	string ReadString() {
+		const auto size = Read<uint32_t>();
+		Check(size);
+		string value(pos, size);
+		pos += size;
+		return value;
+	}
+
+private:
+	const char *pos;
+	const char *const end;
+	const string &path;
+
+	void Check(idx_t size) const {
+		if (static_cast<idx_t>(end - pos) < size) {
+			throw IOException("Bigtable record file \"%s\" is truncated", path);
+		}
+	}
+};
+
+// A record file open for appending. Every recording connection of a path shares it, so that entries appended from
+// connections to different endpoints never interleave.
+class RecordFile {
+public:
+	explicit RecordFile(const string &path) : file(path, std::ios::binary | std::ios::app | std::ios::ate) {
+		if (!file) {
+			throw IOException("Cannot open Bigtable record file \"%s\"", path);
+		}
+		// An append stream only reports the size of the file it extends when opened at its end
+		if (file.tellp() == 0) {
+			file.write(RECORD_MAGIC.data(), RECORD_MAGIC.size());
+			file.flush();
+		} else {
+			std::ifstream existing(path, std::ios::binary);
+			string magic(RECORD_MAGIC.size(), '\0');
+			existing.read(&magic[0], static_cast<std::streamsize>(magic.size()));
+			if (magic != RECORD_MAGIC) {
+				throw IOException("\"%s\" is not a Bigtable record file", path);
+			}
+		}
+	}
+
+	static std::shared_ptr<RecordFile> Get(const string &path) {
+		static mutex lock;
+		static unordered_map<string, std::weak_ptr<RecordFile>> files;
+
+		lock_guard<mutex> guard(lock);
+		auto file = files[path].lock();
+		if (!file) {
+			file = std::make_shared<RecordFile>(path);
+			files[path] = file;
+		}
+		return file;
+	}
+
+	void Append(const string &buffer) {		file->Append(buffer);
+	}
+
+private:
+	mutex lock;
+	std::ofstream file;
+};
+
+class RecordingConnection : public cbt::DataConnection {
+public:
+	RecordingConnection(std::shared_ptr<cbt::DataConnection> inner_p, const string &path)
+	    : inner(std::move(inner_p)), file(RecordFile::Get(path)) {};
+
+	Options options() override {
+		return inner->options();
+	}
+
+	Status Apply(const std::string &table_name, cbt::SingleRowMutation mut) override {
+		return inner->Apply(table_name, std::move(mut));
+	}
+
+	future<Status> AsyncApply(const std::string &table_name, cbt::SingleRowMutation mut) override {
+		return inner->AsyncApply(table_name, std::move(mut));
+	}
+
+	std::vector<cbt::FailedMutation> BulkApply(const std::string &table_name, cbt::BulkMutation mut) override {
+		return inner->BulkApply(table_name, std::move(mut));
+	}
+
+	future<std::vector<cbt::FailedMutation>> AsyncBulkApply(const std::string &table_name,
+	                                                        cbt::BulkMutation mut) override {
+		return inner->AsyncBulkApply(table_name, std::move(mut));
+	}
+
+	StatusOr<std::pair<bool, cbt::Row>> ReadRow(const std::string &table_name, std::string row_key,
+	                                            cbt::Filter filter) override {
+		return inner->ReadRow(table_name, std::move(row_key), std::move(filter));
+	}
+
+	future<StatusOr<std::pair<bool, cbt::Row>>> AsyncReadRow(const std::string &table_name, std::string row_key,
+	                                                        cbt::Filter filter) override {
+		auto key = RequestKey(table_name, row_key, filter);
+		return inner->AsyncReadRow(table_name, std::move(row_key), std::move(filter))
+		    .then([this, key](future<StatusOr<std::pair<bool, cbt::Row>>> response) {
+			    auto result = response.get();
+			    if (result) {
+				    std::vector<cbt::Row> rows;
+				    if (result->first) {
+					    rows.push_back(result->second);
+				    }
+				    Append(key, rows);
+			    }
+			    return result;
+		    });
+	}
+
+	cbt::RowReader ReadRowsFull(cbt::ReadRowsParams params) override {
+		const auto key = RequestKey(params);
+		std::vector<cbt::Row> rows;
+		for (auto &row : inner->ReadRowsFull(std::move(params))) {
+			if (!row) {
+				return cbtm::MakeRowReader(std::move(rows), row.status());
+			}
+			rows.emplace_back(*std::move(row));
+		}
+		Append(key, rows);
+		return cbtm::MakeRowReader(std::move(rows));
+	}
+
+private:
+	const std::shared_ptr<cbt::DataConnection> inner;
+	const std::shared_ptr<RecordFile> file;
+
+	void Append(const string &key, const std::vector<cbt::Row> &rows) {
+		string buffer;
+		WriteString(buffer, key);
+		WriteUint32(buffer, static_cast<uint32_t>(rows.size()));
+		for (const auto &row : rows) {
+			WriteString(buffer, row.row_key());
+			WriteUint32(buffer, static_cast<uint32_t>(row.cells().size()));
+			for (const auto &cell : row.cells()) {
+				WriteString(buffer, cell.family_name());
+				WriteString(buffer, cell.column_qualifier());
+				const int64_t timestamp = cell.timestamp().count();
+				buffer.append(reinterpret_cast<const char *>(&timestamp), sizeof(timestamp));
+				WriteString(buffer, cell.value());
+			}
+		}
+		file->Append(buffer);
+	}
+};
+
+class ReplayConnection : public cbt::DataConnection {
+public:
+	ReplayConnection(const string &path, idx_t latency_ms) : latency(latency_ms) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file) {
+			throw IOException("Cannot open Bigtable record file \"%s\"", path);
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		const auto data = contents.str();
+		if (data.compare(0, RECORD_MAGIC.size(), RECORD_MAGIC) != 0) {
+			throw IOException("\"%s\" is not a Bigtable record file", path);
+		}
+
+		RecordReader reader(data, path);
+		reader.Skip(RECORD_MAGIC.size());
+		while (!reader.AtEnd()) {
+			auto key = reader.ReadString();
+			const auto row_count = reader.Read<uint32_t>();
+			std::vector<cbt::Row> rows;
+			rows.reserve(row_count);
+			for (uint32_t row_idx = 0; row_idx < row_count; row_idx++) {
+				auto row_key = reader.ReadString();
+				const auto cell_count = reader.Read<uint32_t>();
+				std::vector<cbt::Cell> cells;
+				cells.reserve(cell_count);
+				for (uint32_t cell_idx = 0; cell_idx < cell_count; cell_idx++) {
+					auto family = reader.ReadString();
+					auto qualifier = reader.ReadString();
+					const auto timestamp = reader.Read<int64_t>();
+					auto value = reader.ReadString();
+					cells.emplace_back(row_key, std::move(family), std::move(qualifier), timestamp, std::move(value));
+				}
+				rows.emplace_back(std::move(row_key), std::move(cells));
+			}
+			responses.emplace(std::move(key), std::move(rows));
+		}
+	}
+
+	cbt::RowReader ReadRowsFull(cbt::ReadRowsParams params) override {
+		if (latency.count() > 0) {
+			std::this_thread::sleep_for(latency);
+		}
+		const auto it = responses.find(RequestKey(params));
+		if (it == responses.end()) {
+			return cbtm::MakeRowReader({}, Status(StatusCode::kNotFound, "ReadRows request was not recorded"));
+		}
+		return cbtm::MakeRowReader(it->second);
+	}
+
+	// Replies in the calling thread, so hedged reads always resolve with their first attempt
+	future<StatusOr<std::pair<bool, cbt::Row>>> AsyncReadRow(const std::string &table_name, std::string row_key,
+	                                                        cbt::Filter filter) override {
+		if (latency.count() > 0) {
+			std::this_thread::sleep_for(latency);
+		}
+		const auto it = responses.find(RequestKey(table_name, row_key, filter));
+		if (it == responses.end()) {
+			return google::cloud::make_ready_future(StatusOr<std::pair<bool, cbt::Row>>(
+			    Status(StatusCode::kNotFound, "ReadRow request was not recorded")));
+		}
+		if (it->second.empty()) {
+			return google::cloud::make_ready_future(
+			    StatusOr<std::pair<bool, cbt::Row>>(std::make_pair(false, cbt::Row("", {}))));
+		}
+		return google::cloud::make_ready_future(
+		    StatusOr<std::pair<bool, cbt::Row>>(std::make_pair(true, it->second.front())));
+	}
+
+private:
+	const std::chrono::milliseconds latency;
+	unordered_map<string, std::vector<cbt::Row>> responses;
+};
+
+std::shared_ptr<cbt::DataConnection> MakeRecordingConnection(std::shared_ptr<cbt::DataConnection> inner,
+                                                             const string &path) {
+	return std::make_shared<RecordingConnection>(std::move(inner), path);
+}
+
+std::shared_ptr<cbt::DataConnection> MakeReplayConnection(const string &path, idx_t latency_ms) {
+	return std::make_shared<ReplayConnection>(path, latency_ms);
+}
+
+} // namespace duckdb
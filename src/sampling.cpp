@@ -0,0 +1,37 @@
+#include "sampling.hpp"
+
+#include "duckdb.hpp"
+
+#include <random>
+
+namespace duckdb {
+
+ScanSample ScanSample::Get(const BigtableConfig &config, optional_ptr<SampleOptions> options) {
+	ScanSample sample;
+	// DuckDB only pushes down SYSTEM samples given as a percentage
+	if (!options || !options->is_percentage) {
+		return sample;
+	}
+	sample.rate = MinValue(MaxValue(options->sample_size.GetValue<double>() / 100.0, 0.0), 1.0);
+	// A row sample filter needs a rate in (0, 1), an empty sample skips every range instead
+	sample.by_range = config.sample_ranges || sample.rate == 0;
+	sample.seed = options->seed.IsValid() ? options->seed.GetIndex() : std::random_device()();
+	return sample;
+}
+
+cbt::Filter ScanSample::Apply(cbt::Filter filter) const {
+	if (!IsSampled() || by_range) {
+		return filter;
+	}
+	return cbt::Filter::Chain(cbt::Filter::RowSample(rate), std::move(filter));
+}
+
+bool ScanSample::Keep(idx_t group_idx) const {
+	if (!IsSampled() || !by_range) {
+		return true;
+	}
+	const auto hash = Hash<uint64_t>(group_idx ^ seed);
+	return static_cast<double>(hash) < rate * static_cast<double>(NumericLimits<hash_t>::Maximum());
+}
+
+} // namespace duckdb
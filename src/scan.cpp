@@ -0,0 +1,594 @@
+#include "scan.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "utils.hpp"
+
+#include <google/cloud/bigtable/table.h>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+// A `/`-separated part of the row key exposed as a column, e.g. `~pe_id:UBIGINT` for a reversed id.
+struct KeyPart {
+	string name;
+	LogicalType type;
+	idx_t position;
+	bool reversed;
+};
+
+// A family and qualifier exposed as a column, e.g. `'p:p:FLOAT'`.
+struct CellColumn {
+	string name;
+	string family;
+	string qualifier;
+	LogicalType type;
+};
+
+struct ScanFunctionData : TableFunctionData {
+	BigtableConfig config;
+	idx_t key_size;
+	vector<KeyPart> key_parts;
+	vector<CellColumn> cell_columns;
+	// Cell column of each `family:qualifier` key
+	std::unordered_map<string, idx_t> cell_index;
+	vector<cbt::RowRange> ranges;
+
+	// Output columns are the key parts, the cell timestamp, then the cell columns
+	column_t TimestampColumn() const {
+		return key_parts.size();
+	}
+};
+
+template <class T>
+static std::optional<T> DecodeValue(std::string_view value) {
+	if constexpr (std::is_same_v<T, string>) {
+		return string(value);
+	} else if constexpr (std::is_same_v<T, bool>) {
+		return value == "1" || value == "true";
+	} else if constexpr (std::is_same_v<T, uint8_t>) {
+		return ParseUint8(value);
+	} else if constexpr (std::is_same_v<T, uint16_t>) {
+		return ParseUint16(value);
+	} else if constexpr (std::is_same_v<T, uint32_t>) {
+		return ParseUint32(value);
+	} else if constexpr (std::is_same_v<T, uint64_t>) {
+		return ParseUint64(value);
+	} else if constexpr (std::is_same_v<T, int32_t>) {
+		return ParseInt32(value);
+	} else if constexpr (std::is_same_v<T, int64_t>) {
+		return ParseInt64(value);
+	} else if constexpr (std::is_same_v<T, float>) {
+		return ParseFloat(value);
+	} else {
+		static_assert(std::is_same_v<T, double>, "unsupported cell type");
+		return ParseDouble(value);
+	}
+}
+
+// Physical type a column is decoded into.
+enum class CellType : uint8_t {
+	BOOLEAN,
+	UTINYINT,
+	USMALLINT,
+	UINTEGER,
+	UBIGINT,
+	INTEGER,
+	BIGINT,
+	FLOAT,
+	DOUBLE,
+	VARCHAR
+};
+
+static std::optional<CellType> GetCellType(const LogicalType &type) {
+	switch (type.id()) {
+	case LogicalTypeId::BOOLEAN:
+		return CellType::BOOLEAN;
+	case LogicalTypeId::UTINYINT:
+		return CellType::UTINYINT;
+	case LogicalTypeId::USMALLINT:
+		return CellType::USMALLINT;
+	case LogicalTypeId::UINTEGER:
+		return CellType::UINTEGER;
+	case LogicalTypeId::UBIGINT:
+		return CellType::UBIGINT;
+	case LogicalTypeId::INTEGER:
+		return CellType::INTEGER;
+	case LogicalTypeId::BIGINT:
+		return CellType::BIGINT;
+	case LogicalTypeId::FLOAT:
+		return CellType::FLOAT;
+	case LogicalTypeId::DOUBLE:
+		return CellType::DOUBLE;
+	case LogicalTypeId::VARCHAR:
+	case LogicalTypeId::BLOB:
+		return CellType::VARCHAR;
+	default:
+		return std::nullopt;
+	}
+}
+
+// Values of the rows decoded but not yet emitted, kept in the physical type of their column. Fixed-width values
+// take one 8-byte slot each so that a single buffer type serves every column. The decoder and writer of a buffer are
+// instantiations for its column type, picked once when the buffer is made, so a cell costs no switch on the type.
+struct ColumnBuffer {
+	using SetFunction = void (*)(ColumnBuffer &buffer, idx_t row, std::string_view value);
+	using EmitFunction = void (*)(const ColumnBuffer &buffer, Vector &out, idx_t offset, idx_t count);
+
+	const bool is_string;
+	const SetFunction set;
+	const EmitFunction emit;
+	vector<uint64_t> values;
+	vector<string> strings;
+	vector<bool> validity;
+
+	ColumnBuffer(bool is_string_p, SetFunction set_p, EmitFunction emit_p)
+	    : is_string(is_string_p), set(set_p), emit(emit_p) {};
+
+	template <class T>
+	static unique_ptr<ColumnBuffer> Make() {
+		return make_uniq<ColumnBuffer>(std::is_same_v<T, string>, SetValue<T>, EmitValues<T>);
+	}
+
+	void Append() {
+		if (is_string) {
+			strings.emplace_back();
+		} else {
+			values.emplace_back(0);
+		}
+		validity.emplace_back(false);
+	}
+
+	void Set(idx_t row, std::string_view value) {
+		set(*this, row, value);
+	}
+
+	void Emit(Vector &out, idx_t offset, idx_t count) const {
+		emit(*this, out, offset, count);
+	}
+
+	void Clear() {
+		values.clear();
+		strings.clear();
+		validity.clear();
+	}
+
+private:
+	template <class T>
+	static void SetValue(ColumnBuffer &buffer, idx_t row, std::string_view value) {
+		auto decoded = DecodeValue<T>(value);
+		if (!decoded) {
+			return;
+		}
+		if constexpr (std::is_same_v<T, string>) {
+			buffer.strings[row] = std::move(*decoded);
+		} else {
+			memcpy(&buffer.values[row], &*decoded, sizeof(T));
+		}
+		buffer.validity[row] = true;
+	}
+
+	template <class T>
+	static void EmitValues(const ColumnBuffer &buffer, Vector &out, idx_t offset, idx_t count) {
+		auto &out_validity = FlatVector::Validity(out);
+		if constexpr (std::is_same_v<T, string>) {
+			auto *data_ptr = FlatVector::GetData<string_t>(out);
+			for (idx_t i = 0; i < count; i++) {
+				if (buffer.validity[offset + i]) {
+					data_ptr[i] = StringVector::AddStringOrBlob(out, buffer.strings[offset + i]);
+				} else {
+					out_validity.SetInvalid(i);
+				}
+			}
+		} else {
+			auto *data_ptr = FlatVector::GetData<T>(out);
+			for (idx_t i = 0; i < count; i++) {
+				if (buffer.validity[offset + i]) {
+					memcpy(&data_ptr[i], &buffer.values[offset + i], sizeof(T));
+				} else {
+					out_validity.SetInvalid(i);
+				}
+			}
+		}
+	}
+};
+
+static LogicalType ParseColumnType(const string &type_name) {
+	auto type = TransformStringToLogicalType(type_name);
+	if (!GetCellType(type)) {
+		throw BinderException("bigtable_scan: unsupported column type \"%s\"", type_name);
+	}
+	return type;
+}
+
+static unique_ptr<ColumnBuffer> MakeColumnBuffer(const LogicalType &type) {
+	switch (*GetCellType(type)) {
+	case CellType::BOOLEAN:
+		return ColumnBuffer::Make<bool>();
+	case CellType::UTINYINT:
+		return ColumnBuffer::Make<uint8_t>();
+	case CellType::USMALLINT:
+		return ColumnBuffer::Make<uint16_t>();
+	case CellType::UINTEGER:
+		return ColumnBuffer::Make<uint32_t>();
+	case CellType::UBIGINT:
+		return ColumnBuffer::Make<uint64_t>();
+	case CellType::INTEGER:
+		return ColumnBuffer::Make<int32_t>();
+	case CellType::BIGINT:
+		return ColumnBuffer::Make<int64_t>();
+	case CellType::FLOAT:
+		return ColumnBuffer::Make<float>();
+	case CellType::DOUBLE:
+		return ColumnBuffer::Make<double>();
+	case CellType::VARCHAR:
+		return ColumnBuffer::Make<string>();
+	}
+	throw InternalException("bigtable_scan: unhandled cell type");
+}
+
+// Splits a row key or key layout on `/`, keeping empty parts so that positions line up.
+static void SplitKey(std::string_view key, vector<std::string_view> &parts) {
+	parts.clear();
+	for (size_t begin = 0;;) {
+		const auto end = key.find('/', begin);
+		parts.emplace_back(key.substr(begin, end - begin));
+		if (end == std::string_view::npos) {
+			break;
+		}
+		begin = end + 1;
+	}
+}
+
+static void ParseKeyLayout(const string &key_layout, ScanFunctionData &bind_data) {
+	vector<std::string_view> parts;
+	SplitKey(key_layout, parts);
+	bind_data.key_size = parts.size();
+
+	for (idx_t position = 0; position < parts.size(); position++) {
+		string part(parts[position]);
+		if (part.empty() || part == "_") {
+			continue;
+		}
+		KeyPart key_part;
+		key_part.position = position;
+		key_part.reversed = part[0] == '~';
+		if (key_part.reversed) {
+			part = part.substr(1);
+		}
+		const auto type_idx = part.find(':');
+		key_part.name = part.substr(0, type_idx);
+		key_part.type = type_idx == string::npos ? LogicalType::VARCHAR : ParseColumnType(part.substr(type_idx + 1));
+		bind_data.key_parts.emplace_back(std::move(key_part));
+	}
+}
+
+// Family names cannot contain `:`, so it separates them from the qualifier unambiguously.
+static void CellKey(std::string_view family, std::string_view qualifier, string &key) {
+	key.assign(family);
+	key += ':';
+	key.append(qualifier);
+}
+
+static void ParseColumns(const Value &columns, ScanFunctionData &bind_data) {
+	if (columns.type().id() != LogicalTypeId::STRUCT) {
+		throw BinderException("bigtable_scan: columns must be a struct such as {'price': 'p:p:FLOAT'}");
+	}
+	const auto &child_types = StructType::GetChildTypes(columns.type());
+	const auto &children = StructValue::GetChildren(columns);
+
+	for (idx_t i = 0; i < children.size(); i++) {
+		const auto spec = children[i].ToString();
+		const auto family_idx = spec.find(':');
+		if (family_idx == string::npos) {
+			throw BinderException("bigtable_scan: column \"%s\" must be \"family:qualifier[:TYPE]\"", spec);
+		}
+
+		CellColumn column;
+		column.name = child_types[i].first;
+		column.family = spec.substr(0, family_idx);
+		const auto type_idx = spec.rfind(':');
+		if (type_idx == family_idx) {
+			column.qualifier = spec.substr(family_idx + 1);
+			column.type = LogicalType::VARCHAR;
+		} else {
+			column.qualifier = spec.substr(family_idx + 1, type_idx - family_idx - 1);
+			column.type = ParseColumnType(spec.substr(type_idx + 1));
+		}
+		// A cell read by two columns would come back twice, once with its value stripped when one of them is not
+		// projected, and the stripped copy could overwrite the other column
+		string key;
+		CellKey(column.family, column.qualifier, key);
+		if (!bind_data.cell_index.emplace(key, i).second) {
+			throw BinderException("bigtable_scan: cell \"%s\" is mapped to more than one column", key);
+		}
+		bind_data.cell_columns.emplace_back(std::move(column));
+	}
+}
+
+unique_ptr<FunctionData> BigtableScanFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names) {
+	auto bind_data = make_uniq<ScanFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, StringValue::Get(input.inputs[0]));
+	ParseKeyLayout(StringValue::Get(input.inputs[1]), *bind_data);
+
+	for (const auto &prefix : ListValue::GetChildren(input.inputs[2])) {
+		bind_data->ranges.emplace_back(cbt::RowRange::Prefix(StringValue::Get(prefix)));
+	}
+
+	auto columns = input.named_parameters.find("columns");
+	if (columns != input.named_parameters.end()) {
+		ParseColumns(columns->second, *bind_data);
+	}
+
+	for (const auto &key_part : bind_data->key_parts) {
+		names.emplace_back(key_part.name);
+		return_types.emplace_back(key_part.type);
+	}
+	names.emplace_back("timestamp");
+	return_types.emplace_back(LogicalType::TIMESTAMP);
+	for (const auto &column : bind_data->cell_columns) {
+		names.emplace_back(column.name);
+		return_types.emplace_back(column.type);
+	}
+
+	case_insensitive_set_t unique_names;
+	for (const auto &name : names) {
+		if (!unique_names.insert(name).second) {
+			throw BinderException("bigtable_scan: duplicate column name \"%s\"", name);
+		}
+	}
+
+	return bind_data;
+}
+
+// Reads every mapped column so that projection does not change which timestamps produce rows,
+// stripping the values of the columns that are not projected.
+static cbt::Filter MakeScanFilter(const ScanFunctionData &bind_data, const vector<column_t> &column_ids) {
+	if (bind_data.cell_columns.empty()) {
+		return cbt::Filter::StripValueTransformer();
+	}
+
+	vector<bool> projected(bind_data.cell_columns.size(), false);
+	for (const auto column_id : column_ids) {
+		if (column_id > bind_data.TimestampColumn() && column_id != COLUMN_IDENTIFIER_ROW_ID) {
+			projected[column_id - bind_data.TimestampColumn() - 1] = true;
+		}
+	}
+
+	vector<cbt::Filter> values;
+	vector<cbt::Filter> stripped;
+	for (idx_t i = 0; i < bind_data.cell_columns.size(); i++) {
+		const auto &column = bind_data.cell_columns[i];
+		auto filter = cbt::Filter::ColumnRangeClosed(column.family, column.qualifier, column.qualifier);
+		(projected[i] ? values : stripped).emplace_back(std::move(filter));
+	}
+
+	if (!stripped.empty()) {
+		auto strip = stripped.size() == 1 ? std::move(stripped[0])
+		                                  : cbt::Filter::InterleaveFromRange(stripped.begin(), stripped.end());
+		values.emplace_back(cbt::Filter::Chain(std::move(strip), cbt::Filter::StripValueTransformer()));
+	}
+	if (values.size() == 1) {
+		return std::move(values[0]);
+	}
+	return cbt::Filter::InterleaveFromRange(values.begin(), values.end());
+}
+
+struct ScanGlobalState : GlobalTableFunctionState {
+	const cbt::Filter filter;
+	RangeReader reader;
+
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
+	const vector<column_t> column_ids;
+	ScanProfiles profiles;
+
+	ScanGlobalState(const ScanFunctionData &bind_data, vector<column_t> column_ids_p)
+	    : filter(MakeScanFilter(bind_data, column_ids_p)), reader(bind_data.config), scheduler(bind_data.ranges),
+	      max_inflight(bind_data.config.max_inflight), column_ids(std::move(column_ids_p)),
+	      profiles(bind_data.config) {};
+
+	idx_t MaxThreads() const override {
+		return MinValue(scheduler.MaxThreads(), max_inflight);
+	}
+};
+
+unique_ptr<GlobalTableFunctionState> BigtableScanInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<ScanFunctionData>();
+	return make_uniq<ScanGlobalState>(bind_data, input.column_ids);
+}
+
+struct ScanLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	idx_t remainder_idx = 0;
+	idx_t remainder_size = 0;
+	vector<timestamp_t> timestamps;
+	// Buffer of each key part and cell column, nullptr when the column is not projected
+	vector<unique_ptr<ColumnBuffer>> key_buffers;
+	vector<unique_ptr<ColumnBuffer>> cell_buffers;
+	// Timestamp and buffered row of each timestamp of the current Bigtable row, by descending timestamp
+	vector<std::pair<int64_t, idx_t>> row_slots;
+	vector<std::string_view> key_values;
+	string reversed;
+	string cell_key;
+
+	explicit ScanLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> BigtableScanInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state) {
+	auto &bind_data = input.bind_data->Cast<ScanFunctionData>();
+	auto local_state = make_uniq<ScanLocalState>(global_state->Cast<ScanGlobalState>().profiles.Register());
+	local_state->key_buffers.resize(bind_data.key_parts.size());
+	local_state->cell_buffers.resize(bind_data.cell_columns.size());
+
+	for (const auto column_id : input.column_ids) {
+		if (column_id < bind_data.TimestampColumn()) {
+			local_state->key_buffers[column_id] = MakeColumnBuffer(bind_data.key_parts[column_id].type);
+		} else if (column_id > bind_data.TimestampColumn() && column_id != COLUMN_IDENTIFIER_ROW_ID) {
+			const auto cell_idx = column_id - bind_data.TimestampColumn() - 1;
+			local_state->cell_buffers[cell_idx] = MakeColumnBuffer(bind_data.cell_columns[cell_idx].type);
+		}
+	}
+	return local_state;
+}
+
+// Returns the buffered row of a cell timestamp, appending a row filled with the key parts on first sight.
+static idx_t GetRow(const ScanFunctionData &bind_data, ScanLocalState &local_state, int64_t timestamp) {
+	auto &row_slots = local_state.row_slots;
+	auto it = std::lower_bound(row_slots.begin(), row_slots.end(), timestamp,
+	                           [](const std::pair<int64_t, idx_t> &slot, int64_t ts) { return slot.first > ts; });
+	if (it != row_slots.end() && it->first == timestamp) {
+		return it->second;
+	}
+
+	const idx_t row = local_state.remainder_size++;
+	row_slots.insert(it, {timestamp, row});
+	local_state.timestamps.emplace_back(Timestamp::FromEpochMicroSeconds(timestamp));
+
+	for (idx_t i = 0; i < bind_data.key_parts.size(); i++) {
+		auto &buffer = local_state.key_buffers[i];
+		if (!buffer) {
+			continue;
+		}
+		buffer->Append();
+		const auto &key_part = bind_data.key_parts[i];
+		std::string_view value = local_state.key_values[key_part.position];
+		if (key_part.reversed) {
+			local_state.reversed.assign(value.rbegin(), value.rend());
+			value = local_state.reversed;
+		}
+		buffer->Set(row, value);
+	}
+	for (auto &buffer : local_state.cell_buffers) {
+		if (buffer) {
+			buffer->Append();
+		}
+	}
+	return row;
+}
+
+static void ClearBuffers(ScanLocalState &local_state) {
+	local_state.remainder_idx = 0;
+	local_state.remainder_size = 0;
+	local_state.timestamps.clear();
+	for (auto &buffer : local_state.key_buffers) {
+		if (buffer) {
+			buffer->Clear();
+		}
+	}
+	for (auto &buffer : local_state.cell_buffers) {
+		if (buffer) {
+			buffer->Clear();
+		}
+	}
+}
+
+void BigtableScanFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	const auto &bind_data = data.bind_data->Cast<ScanFunctionData>();
+	auto &global_state = data.global_state->Cast<ScanGlobalState>();
+	auto &local_state = data.local_state->Cast<ScanLocalState>();
+
+	if (local_state.remainder_idx == local_state.remainder_size) {
+		ClearBuffers(local_state);
+	}
+
+	while ((local_state.remainder_size - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+
+		const auto &range = global_state.scheduler.ranges[range_idx];
+
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			SplitKey(row.row_key(), local_state.key_values);
+			if (local_state.key_values.size() < bind_data.key_size) {
+				ScanProfile::Add(local_state.profile.filtered, 1);
+				return;
+			}
+
+			local_state.row_slots.clear();
+			// Cells of a column are adjacent in a row, so the index is only looked up when the column changes
+			ColumnBuffer *buffer = nullptr;
+			bool mapped = false;
+			const cbt::Cell *previous = nullptr;
+			for (const auto &cell : row.cells()) {
+				if (bind_data.cell_columns.empty()) {
+					GetRow(bind_data, local_state, cell.timestamp().count());
+					continue;
+				}
+
+				if (!previous || previous->family_name() != cell.family_name() ||
+				    previous->column_qualifier() != cell.column_qualifier()) {
+					CellKey(cell.family_name(), cell.column_qualifier(), local_state.cell_key);
+					const auto entry = bind_data.cell_index.find(local_state.cell_key);
+					mapped = entry != bind_data.cell_index.end();
+					buffer = mapped ? local_state.cell_buffers[entry->second].get() : nullptr;
+				}
+				previous = &cell;
+				if (!mapped) {
+					continue;
+				}
+
+				const auto row_idx = GetRow(bind_data, local_state, cell.timestamp().count());
+				if (buffer) {
+					buffer->Set(row_idx, cell.value());
+				}
+			}
+		});
+	}
+
+	const idx_t count = std::min((idx_t)STANDARD_VECTOR_SIZE, local_state.remainder_size - local_state.remainder_idx);
+
+	if (count == 0) {
+		output.SetCardinality(0);
+		return;
+	}
+
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
+	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+		auto &out_vec = output.data[col_idx];
+		const auto column_id = global_state.column_ids[col_idx];
+
+		if (column_id == COLUMN_IDENTIFIER_ROW_ID) {
+			continue;
+		} else if (column_id < bind_data.TimestampColumn()) {
+			local_state.key_buffers[column_id]->Emit(out_vec, local_state.remainder_idx, count);
+		} else if (column_id == bind_data.TimestampColumn()) {
+			auto *data_ptr = FlatVector::GetData<timestamp_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = local_state.timestamps[local_state.remainder_idx + i];
+			}
+		} else {
+			const auto cell_idx = column_id - bind_data.TimestampColumn() - 1;
+			local_state.cell_buffers[cell_idx]->Emit(out_vec, local_state.remainder_idx, count);
+		}
+	}
+
+	local_state.remainder_idx += count;
+	output.SetCardinality(count);
+}
+
+double BigtableScanProgress(ClientContext &context, const FunctionData *bind_data,
+                            const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<ScanGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> BigtableScanDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<ScanGlobalState>().profiles.ToMap();
+}
+
+} // namespace duckdb
@@ -1,16 +1,21 @@
 #include "search.hpp"
 
+#include "cardinality.hpp"
+#include "config.hpp"
 #include "duckdb.hpp"
+#include "duckdb/common/types/bit.hpp"
+#include "keys.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "sampling.hpp"
 #include "utils.hpp"
 
+#include <bit>
 #include <google/cloud/bigtable/table.h>
 #include <optional>
 #include <string_view>
-#include <unordered_map>
 
-using ::google::cloud::GrpcNumChannelsOption;
-using ::google::cloud::Options;
-using ::google::cloud::StatusOr;
 namespace cbt = ::google::cloud::bigtable;
 
 namespace duckdb {
@@ -36,50 +41,126 @@ struct Keyword {
 	bool is_paid = false;
 };
 
+// The results of one row, one slot per hour of the week and position, reused from row to row. Occupied slots are
+// tracked in a bitmap, so that a row is drained in (hour, position) order by visiting only its set bits.
+struct KeywordSlots {
+	static constexpr idx_t SLOTS = 7 * 24 * MAX_POSITION;
+	static constexpr idx_t WORDS = (SLOTS + 63) / 64;
+
+	vector<Keyword> slots;
+	std::array<uint64_t, WORDS> occupied {};
+	idx_t count = 0;
+
+	KeywordSlots() : slots(SLOTS) {};
+
+	// Returns the result of a slot, starting it over on its first cell of the row
+	Keyword &Emplace(uint32_t slot, uint32_t keyword_id, uint32_t shop_id, timestamp_t date, uint8_t position) {
+		auto &word = occupied[slot / 64];
+		const auto bit = uint64_t(1) << (slot % 64);
+		auto &keyword = slots[slot];
+		if (!(word & bit)) {
+			word |= bit;
+			count++;
+			keyword = Keyword {keyword_id, shop_id, date, position};
+		}
+		return keyword;
+	}
+
+	// Moves the results of the row out in slot order and empties every slot
+	void Drain(vector<Keyword> &out) {
+		out.reserve(out.size() + count);
+		for (idx_t word_idx = 0; word_idx < WORDS && count > 0; word_idx++) {
+			auto word = occupied[word_idx];
+			occupied[word_idx] = 0;
+			while (word) {
+				out.emplace_back(std::move(slots[word_idx * 64 + std::countr_zero(word)]));
+				word &= word - 1;
+				count--;
+			}
+		}
+	}
+};
+
 struct SearchFunctionData : TableFunctionData {
+	BigtableConfig config;
 	vector<uint32_t> keyword_ids;
 	vector<uint32_t> shop_ids;
 	vector<cbt::RowRange> ranges;
+	int32_t week_start;
+	int32_t week_end;
+	// Weeks read by each range, a single one for the point ranges of given shops
+	idx_t range_weeks;
+	optional_ptr<RowEstimate> estimate;
+	// Emit ranges in (keyword_id, shop_id) order, each range hour by hour and position by position as its own partition
+	bool ordered = false;
 };
 
-static cbt::Filter make_filter(const vector<column_t> &column_ids);
+// Ranges of given shops are laid out shop by shop, each covering every keyword_id in order, or keyword by keyword
+// when the output is ordered. Without shops there is one range per keyword_id.
+static idx_t KeywordIndex(idx_t range_idx, idx_t keyword_count, idx_t shop_count, bool ordered) {
+	if (shop_count == 0) {
+		return range_idx;
+	}
+	return ordered ? range_idx / shop_count : range_idx % keyword_count;
+}
 
-unique_ptr<FunctionData> SearchFunctionBind(ClientContext &context, TableFunctionBindInput &input,
-                                            vector<LogicalType> &return_types, vector<string> &names) {
-	names = {"keyword_id", "shop_id", "date", "position", "pe_id", "retailer_p_id", "is_paid"};
-	return_types = {LogicalType::UINTEGER, LogicalType::UINTEGER, LogicalType::TIMESTAMP_S, LogicalType::UTINYINT,
-	                LogicalType::UBIGINT,  LogicalType::VARCHAR,  LogicalType::BOOLEAN};
+static idx_t ShopIndex(idx_t range_idx, idx_t keyword_count, idx_t shop_count, bool ordered) {
+	return ordered ? range_idx % shop_count : range_idx / keyword_count;
+}
+
+static cbt::Filter make_filter(const vector<column_t> &column_ids);
 
+// Binds the ranges of search and its variants, whose row estimates are kept apart under `estimate_prefix`
+static unique_ptr<SearchFunctionData> BindSearchRanges(ClientContext &context, TableFunctionBindInput &input,
+                                                       const string &estimate_prefix) {
 	auto bind_data = make_uniq<SearchFunctionData>();
-	const auto week_start = std::to_string(IntegerValue::Get(input.inputs[0]));
-	const auto week_end = std::to_string(IntegerValue::Get(input.inputs[1]));
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "search"));
+	bind_data->week_start = IntegerValue::Get(input.inputs[0]);
+	bind_data->week_end = IntegerValue::Get(input.inputs[1]);
+	const auto week_start = std::to_string(bind_data->week_start);
+	const auto week_end = std::to_string(bind_data->week_end);
 	const auto &ls_keyword_id = ListValue::GetChildren(input.inputs[2]);
-	
-	vector<string> prefix_ids;
-	prefix_ids.reserve(ls_keyword_id.size());
-	bind_data->keyword_ids.reserve(ls_keyword_id.size());
+	const auto ordered_param = input.named_parameters.find("ordered");
+	bind_data->ordered =
+	    ordered_param != input.named_parameters.end() && BooleanValue::Get(ordered_param->second);
 
+	bind_data->keyword_ids.reserve(ls_keyword_id.size());
 	for (const auto &p : ls_keyword_id) {
-		const auto keyword_id = IntegerValue::Get(p);
-		bind_data->keyword_ids.emplace_back(keyword_id);
-		string prefix_id = std::to_string(keyword_id);
-		std::reverse(prefix_id.begin(), prefix_id.end());
-		prefix_ids.emplace_back(std::move(prefix_id));
+		bind_data->keyword_ids.emplace_back(IntegerValue::Get(p));
+	}
+	if (bind_data->ordered) {
+		std::sort(bind_data->keyword_ids.begin(), bind_data->keyword_ids.end());
+	}
+
+	vector<string> prefix_ids;
+	prefix_ids.reserve(bind_data->keyword_ids.size());
+	for (const auto keyword_id : bind_data->keyword_ids) {
+		prefix_ids.emplace_back(ReverseId(keyword_id));
 	}
 
-	if (input.inputs.size() == 4) {
+	const bool point = input.inputs.size() == 4;
+	bind_data->range_weeks = point ? 1 : WeekCount(bind_data->week_start, bind_data->week_end);
+	bind_data->estimate = &RowEstimate::Get(bind_data->config, estimate_prefix + (point ? "point" : "span"));
+
+	if (point) {
 		const auto &ls_shop_id = ListValue::GetChildren(input.inputs[3]);
 		bind_data->shop_ids.reserve(ls_shop_id.size());
-		bind_data->ranges.reserve(prefix_ids.size() * ls_shop_id.size());
-
 		for (const auto &s : ls_shop_id) {
-			const auto shop_id = IntegerValue::Get(s);
-			bind_data->shop_ids.emplace_back(shop_id);
+			bind_data->shop_ids.emplace_back(IntegerValue::Get(s));
+		}
+		if (bind_data->ordered) {
+			std::sort(bind_data->shop_ids.begin(), bind_data->shop_ids.end());
+		}
 
-			for (const auto &p : prefix_ids) {
-				const auto row_key = p + "/" + week_start + "/" + std::to_string(shop_id);
-				bind_data->ranges.emplace_back(cbt::RowRange::Closed(row_key, row_key));
-			}
+		const auto keyword_count = prefix_ids.size();
+		const auto shop_count = bind_data->shop_ids.size();
+		bind_data->ranges.reserve(keyword_count * shop_count);
+		const auto ordered = bind_data->ordered;
+		for (idx_t range_idx = 0; range_idx < keyword_count * shop_count; range_idx++) {
+			const auto &p = prefix_ids[KeywordIndex(range_idx, keyword_count, shop_count, ordered)];
+			const auto shop_id = bind_data->shop_ids[ShopIndex(range_idx, keyword_count, shop_count, ordered)];
+			const auto row_key = p + "/" + week_start + "/" + std::to_string(shop_id);
+			bind_data->ranges.emplace_back(cbt::RowRange::Closed(row_key, row_key));
 		}
 	} else {
 		bind_data->ranges.reserve(prefix_ids.size());
@@ -94,113 +175,165 @@ unique_ptr<FunctionData> SearchFunctionBind(ClientContext &context, TableFunctio
 	return bind_data;
 }
 
+unique_ptr<FunctionData> SearchFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                            vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"keyword_id", "shop_id", "date", "position", "pe_id", "retailer_p_id", "is_paid"};
+	return_types = {LogicalType::UINTEGER, LogicalType::UINTEGER, LogicalType::TIMESTAMP_S, LogicalType::UTINYINT,
+	                LogicalType::UBIGINT,  LogicalType::VARCHAR,  LogicalType::BOOLEAN};
+	return BindSearchRanges(context, input, "");
+}
+
 struct SearchGlobalState : GlobalTableFunctionState {
 	const cbt::Filter filter;
-	cbt::Table table;
-	mutex lock;
-	idx_t ranges_idx = 0;
+	RangeReader reader;
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
 	const vector<uint32_t> keyword_ids;
-	const vector<cbt::RowRange> ranges;
+	const vector<uint32_t> shop_ids;
+	const bool ordered;
 	const vector<column_t> column_ids;
-	SearchGlobalState(vector<uint32_t> keyword_ids_p, vector<cbt::RowRange> ranges_p, vector<column_t> column_ids_p)
-	    : filter(make_filter(column_ids_p)), table(cbt::MakeDataConnection(Options {}.set<GrpcNumChannelsOption>(32)),
-	                                               cbt::TableResource("dataimpact-processing", "processing", "search")),
-	      keyword_ids(std::move(keyword_ids_p)), ranges(std::move(ranges_p)), column_ids(std::move(column_ids_p)) {};
+	ScanProfiles profiles;
+	RowEstimate &estimate;
+	const idx_t range_weeks;
+	// Ranges read to the end and the rows decoded from them, emitted or not
+	atomic<idx_t> ranges_read {0};
+	atomic<idx_t> rows_read {0};
+	SearchGlobalState(const SearchFunctionData &bind_data, cbt::Filter filter_p, vector<cbt::RowRange> ranges_p,
+	                  vector<column_t> column_ids_p, ScanSample sample)
+	    : filter(sample.Apply(std::move(filter_p))), reader(bind_data.config),
+	      scheduler(std::move(ranges_p), 1, sample),
+	      max_inflight(bind_data.config.max_inflight), keyword_ids(bind_data.keyword_ids),
+	      shop_ids(bind_data.shop_ids), ordered(bind_data.ordered), column_ids(std::move(column_ids_p)),
+	      profiles(bind_data.config), estimate(*bind_data.estimate), range_weeks(bind_data.range_weeks) {};
+
+	uint32_t KeywordId(idx_t range_idx) const {
+		return keyword_ids[KeywordIndex(range_idx, keyword_ids.size(), shop_ids.size(), ordered)];
+	}
+
+	uint32_t ShopId(idx_t range_idx) const {
+		return shop_ids[ShopIndex(range_idx, keyword_ids.size(), shop_ids.size(), ordered)];
+	}
+
+	~SearchGlobalState() override {
+		// A scan stopped early by a LIMIT or an error, or sampled, says nothing about the rows of its ranges
+		if (ranges_read.load() == scheduler.ranges.size() && !scheduler.sample.IsSampled()) {
+			estimate.Learn(scheduler.ranges.size() * range_weeks, rows_read.load());
+		}
+	}
 
 	idx_t MaxThreads() const override {
-		return ranges.size();
+		return MinValue(scheduler.MaxThreads(), max_inflight);
 	}
 };
 
 unique_ptr<GlobalTableFunctionState> SearchInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
 	auto &bind_data = input.bind_data->Cast<SearchFunctionData>();
-	return make_uniq<SearchGlobalState>(std::move(bind_data.keyword_ids), std::move(bind_data.ranges),
-	                                    std::move(input.column_ids));
+	auto filter = make_filter(input.column_ids);
+	auto sample = ScanSample::Get(bind_data.config, input.sample_options);
+	return make_uniq<SearchGlobalState>(bind_data, std::move(filter), std::move(bind_data.ranges),
+	                                    std::move(input.column_ids), sample);
 }
 
 struct SearchLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
 	idx_t remainder_idx = 0;
 	vector<Keyword> remainder;
-	std::unordered_map<uint32_t, Keyword> keyword_map;
+	KeywordSlots keyword_slots;
+	// Range the rows of the remainder were last read from, the partition of the chunk in ordered mode
+	idx_t range_idx = 0;
+
+	explicit SearchLocalState(ScanProfile &profile_p) : profile(profile_p) {};
 };
 
 unique_ptr<LocalTableFunctionState> SearchInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
                                                     GlobalTableFunctionState *global_state) {
-	return make_uniq<SearchLocalState>();
+	return make_uniq<SearchLocalState>(global_state->Cast<SearchGlobalState>().profiles.Register());
 }
 
-void SearchFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
-	auto &global_state = data.global_state->Cast<SearchGlobalState>();
-	auto &local_state = data.local_state->Cast<SearchLocalState>();
+// Decodes the results of a row into its slots, which are left for the caller to drain
+static void DecodeRow(uint32_t keyword_id, const cbt::Row &row, KeywordSlots &keyword_slots, ScanProfile &profile) {
+	const std::string_view row_key = row.row_key();
+	const auto index = row_key.find_last_of('/');
+	const auto shop_id_opt = ParseUint32(row_key.substr(index + 1));
+	if (!shop_id_opt) {
+		ScanProfile::Add(profile.filtered, 1);
+		return;
+	}
+	const auto shop_id = *shop_id_opt;
 
-	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
-		idx_t range_idx;
-		{
-			lock_guard<mutex> guard(global_state.lock);
-			if (global_state.ranges_idx == global_state.ranges.size()) {
-				break;
-			}
-			range_idx = global_state.ranges_idx++;
+	for (const auto &cell : row.cells()) {
+		const auto position_opt = ParseUint8(cell.column_qualifier());
+		if (!position_opt || *position_opt == 0 || *position_opt > MAX_POSITION) {
+			ScanProfile::Add(profile.filtered, 1);
+			continue;
 		}
+		const auto position = *position_opt;
 
-		const auto keyword_id = global_state.keyword_ids[range_idx];
-		const auto &range = global_state.ranges[range_idx];
+		const std::string_view value = cell.value();
+		if (value.starts_with("id_ret_pos_")) {
+			ScanProfile::Add(profile.filtered, 1);
+			continue;
+		}
 
-		for (const StatusOr<cbt::Row> &row_result : global_state.table.ReadRows(range, global_state.filter)) {
-			if (!row_result) {
-				throw std::runtime_error(row_result.status().message());
-			}
-			const auto &row = row_result.value();
-			const std::string_view row_key = row.row_key();
-			const auto index = row_key.find_last_of('/');
-			const auto shop_id_opt = ParseUint32(row_key.substr(index + 1));
-			if (!shop_id_opt) {
-				continue;
+		const timestamp_t timestamp = Timestamp::FromEpochMicroSeconds(cell.timestamp().count());
+		const date_t date = Timestamp::GetDate(timestamp);
+		const int32_t weekday = Date::ExtractISODayOfTheWeek(date) - 1;
+		const int32_t hour = Timestamp::GetTime(timestamp).micros / 3'600'000'000;
+		const int32_t week_hour = weekday * 24 + hour;
+		const uint32_t slot = week_hour * MAX_POSITION + position - 1;
+
+		auto &keyword = keyword_slots.Emplace(slot, keyword_id, shop_id, timestamp, position);
+
+		switch (cell.family_name()[0]) {
+		case 'p':
+			if (value.starts_with("id_ret_")) {
+				keyword.retailer_p_id = string(value.substr(7));
+			} else {
+				keyword.pe_id = ParseUint64(value);
 			}
-			const auto shop_id = *shop_id_opt;
-
-			for (const auto &cell : row.cells()) {
-				const auto position_opt = ParseUint8(cell.column_qualifier());
-				if (!position_opt || *position_opt == 0 || *position_opt > MAX_POSITION) {
-					continue;
-				}
-				const auto position = *position_opt;
+			break;
+		case 's':
+			keyword.is_paid = true;
+			break;
+		}
+	}
+}
 
-				const std::string_view value = cell.value();
-				if (value.starts_with("id_ret_pos_")) {
-					continue;
-				}
+void SearchFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<SearchGlobalState>();
+	auto &local_state = data.local_state->Cast<SearchLocalState>();
 
-				const timestamp_t timestamp = Timestamp::FromEpochMicroSeconds(cell.timestamp().count());
-				const date_t date = Timestamp::GetDate(timestamp);
-				const int32_t weekday = Date::ExtractISODayOfTheWeek(date) - 1;
-				const int32_t hour = Timestamp::GetTime(timestamp).micros / 3'600'000'000;
-				const int32_t week_hour = weekday * 24 + hour;
-				const uint32_t map_key = week_hour * MAX_POSITION + position - 1;
-
-				auto &keyword =
-				    local_state.keyword_map.try_emplace(map_key, Keyword {keyword_id, shop_id, timestamp, position})
-				        .first->second;
-
-				switch (cell.family_name()[0]) {
-				case 'p':
-					if (value.starts_with("id_ret_")) {
-						keyword.retailer_p_id = string(value.substr(7));
-					} else {
-						keyword.pe_id = ParseUint64(value);
-					}
-					break;
-				case 's':
-					keyword.is_paid = true;
-					break;
-				}
+	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		// In ordered mode a chunk never mixes rows of two ranges, so that each range is a partition
+		if (global_state.ordered) {
+			if (local_state.remainder_idx < local_state.remainder.size()) {
+				break;
 			}
+			local_state.remainder_idx = 0;
+			local_state.remainder.clear();
+		}
 
-			local_state.remainder.reserve(local_state.remainder.size() + local_state.keyword_map.size());
-			for (auto &pair : local_state.keyword_map) {
-				local_state.remainder.emplace_back(std::move(pair.second));
-			}
-			local_state.keyword_map.clear();
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+		local_state.range_idx = range_idx;
+
+		const auto keyword_id = global_state.KeywordId(range_idx);
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		const auto rows_before = local_state.remainder.size();
+
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			DecodeRow(keyword_id, row, local_state.keyword_slots, local_state.profile);
+			local_state.keyword_slots.Drain(local_state.remainder);
+		});
+		global_state.rows_read.fetch_add(local_state.remainder.size() - rows_before, std::memory_order_relaxed);
+		global_state.ranges_read.fetch_add(1, std::memory_order_relaxed);
+
+		// A range over every shop reads week by week, with the shops of a week in row key order
+		if (global_state.ordered && global_state.shop_ids.empty()) {
+			std::stable_sort(local_state.remainder.begin(), local_state.remainder.end(),
+			                 [](const Keyword &a, const Keyword &b) { return a.shop_id < b.shop_id; });
 		}
 	}
 
@@ -213,6 +346,7 @@ void SearchFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 		return;
 	}
 
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
 	const auto *keywords = &local_state.remainder[local_state.remainder_idx];
 
 	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
@@ -288,13 +422,309 @@ void SearchFunction(ClientContext &context, TableFunctionInput &data, DataChunk
 
 double SearchScanProgress(ClientContext &context, const FunctionData *bind_data,
                           const GlobalTableFunctionState *global_state) {
-	const auto &gstate = global_state->Cast<SearchGlobalState>();
-	const auto total_count = gstate.ranges.size();
-	if (total_count == 0) {
-		return 100.0;
+	return global_state->Cast<SearchGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> SearchDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<SearchGlobalState>().profiles.ToMap();
+}
+
+TablePartitionInfo SearchPartitionInfo(ClientContext &context, TableFunctionPartitionInput &input) {
+	const auto &data = input.bind_data->Cast<SearchFunctionData>();
+	if (!data.ordered) {
+		return TablePartitionInfo::NOT_PARTITIONED;
+	}
+	for (const auto column_id : input.partition_ids) {
+		const bool single_value = column_id == SearchColumn::KEYWORD_ID ||
+		                          (column_id == SearchColumn::SHOP_ID && !data.shop_ids.empty());
+		if (!single_value) {
+			return TablePartitionInfo::NOT_PARTITIONED;
+		}
+	}
+	return TablePartitionInfo::SINGLE_VALUE_PARTITIONS;
+}
+
+OperatorPartitionData SearchPartitionData(ClientContext &context, TableFunctionGetPartitionInput &input) {
+	const auto &global_state = input.global_state->Cast<SearchGlobalState>();
+	const auto &local_state = input.local_state->Cast<SearchLocalState>();
+	OperatorPartitionData partition(local_state.range_idx);
+	for (const auto column_id : input.partition_info.partition_columns) {
+		switch (column_id) {
+		case SearchColumn::KEYWORD_ID:
+			partition.partition_data.emplace_back(Value::UINTEGER(global_state.KeywordId(local_state.range_idx)));
+			break;
+		case SearchColumn::SHOP_ID:
+			partition.partition_data.emplace_back(Value::UINTEGER(global_state.ShopId(local_state.range_idx)));
+			break;
+		default:
+			throw InternalException("search: column %d is not a partition column", column_id);
+		}
+	}
+	return partition;
+}
+
+// Estimates the rows of a scan that emits at most `max_rows_per_week` rows for each range and week of one shop
+static unique_ptr<NodeStatistics> EstimateRows(const SearchFunctionData &data, idx_t max_rows_per_week) {
+	const auto range_weeks = data.ranges.size() * data.range_weeks;
+	const auto rows_per_range_week = data.estimate->RowsPerRangeWeek();
+	if (data.shop_ids.empty()) {
+		// A span covers every shop, so nothing bounds its rows until a scan of the table has completed
+		if (!rows_per_range_week) {
+			return nullptr;
+		}
+		return make_uniq<NodeStatistics>(static_cast<idx_t>(*rows_per_range_week * static_cast<double>(range_weeks)));
 	}
-	const auto completed = static_cast<double>(gstate.ranges_idx);
-	return (100.0 * completed) / static_cast<double>(total_count);
+	const auto max_rows = range_weeks * max_rows_per_week;
+	const auto rows = rows_per_range_week ? static_cast<idx_t>(*rows_per_range_week * static_cast<double>(range_weeks))
+	                                      : max_rows;
+	return make_uniq<NodeStatistics>(MinValue(rows, max_rows), max_rows);
+}
+
+unique_ptr<NodeStatistics> SearchCardinality(ClientContext &context, const FunctionData *bind_data) {
+	// A point range holds at most one result per hour of its week and position
+	return EstimateRows(bind_data->Cast<SearchFunctionData>(), 7 * 24 * MAX_POSITION);
+}
+
+enum class RankedColumn : column_t { KEYWORD_ID = 0, SHOP_ID = 1, DATE = 2, PE_IDS = 3, RETAILER_P_IDS = 4, PAID = 5 };
+constexpr idx_t PAID_WORDS = (MAX_POSITION + 63) / 64;
+
+// The results of a keyword in a shop over one hour, position by position
+struct RankedHour {
+	uint32_t keyword_id;
+	uint32_t shop_id;
+	timestamp_t date;
+	// Result of each position up to the last one holding one, NULL for retailer results and empty positions
+	vector<std::optional<uint64_t>> pe_ids;
+	// Retailer results and their positions
+	vector<std::pair<uint8_t, string>> retailer_p_ids;
+	// Paid positions, bit `position - 1` of the hour's slots
+	std::array<uint64_t, PAID_WORDS> paid {};
+};
+
+unique_ptr<FunctionData> SearchRankedFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                                  vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"keyword_id", "shop_id", "date", "pe_ids", "retailer_p_ids", "paid"};
+	return_types = {LogicalType::UINTEGER,
+	                LogicalType::UINTEGER,
+	                LogicalType::TIMESTAMP_S,
+	                LogicalType::LIST(LogicalType::UBIGINT),
+	                LogicalType::LIST(LogicalType::VARCHAR),
+	                LogicalType::BIT};
+	return BindSearchRanges(context, input, "ranked ");
+}
+
+unique_ptr<GlobalTableFunctionState> SearchRankedInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<SearchFunctionData>();
+	// Families are picked like those of the search columns the lists are made of
+	vector<column_t> search_columns;
+	for (const auto column_id : input.column_ids) {
+		switch (static_cast<RankedColumn>(column_id)) {
+		case RankedColumn::PE_IDS:
+		case RankedColumn::RETAILER_P_IDS:
+			search_columns.push_back(SearchColumn::PE_ID);
+			break;
+		case RankedColumn::PAID:
+			search_columns.push_back(SearchColumn::IS_PAID);
+			break;
+		default:
+			break;
+		}
+	}
+	auto filter = make_filter(search_columns);
+	auto sample = ScanSample::Get(bind_data.config, input.sample_options);
+	return make_uniq<SearchGlobalState>(bind_data, std::move(filter), std::move(bind_data.ranges),
+	                                    std::move(input.column_ids), sample);
+}
+
+struct SearchRankedLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	idx_t remainder_idx = 0;
+	vector<RankedHour> remainder;
+	KeywordSlots keyword_slots;
+	vector<Keyword> keywords;
+
+	explicit SearchRankedLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> SearchRankedInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                          GlobalTableFunctionState *global_state) {
+	return make_uniq<SearchRankedLocalState>(global_state->Cast<SearchGlobalState>().profiles.Register());
+}
+
+static int64_t HourOf(timestamp_t timestamp) {
+	return timestamp.value - timestamp.value % Interval::MICROS_PER_HOUR;
+}
+
+// Folds the results of a row, drained in (hour, position) order, into one ranked hour per hour. Results of an hour
+// can carry different timestamps, the slots still order them by position, so the last one holds the highest position.
+static void RankHours(vector<Keyword> &keywords, vector<RankedHour> &out) {
+	idx_t begin = 0;
+	while (begin < keywords.size()) {
+		const auto hour = HourOf(keywords[begin].date);
+		idx_t end = begin + 1;
+		while (end < keywords.size() && HourOf(keywords[end].date) == hour) {
+			end++;
+		}
+		const uint8_t last_position = keywords[end - 1].position;
+
+		auto &ranked = out.emplace_back();
+		ranked.keyword_id = keywords[begin].keyword_id;
+		ranked.shop_id = keywords[begin].shop_id;
+		ranked.date = timestamp_t(hour);
+		ranked.pe_ids.resize(last_position);
+		for (idx_t i = begin; i < end; i++) {
+			auto &keyword = keywords[i];
+			const idx_t bit = keyword.position - 1;
+			ranked.pe_ids[bit] = keyword.pe_id;
+			if (keyword.retailer_p_id) {
+				ranked.retailer_p_ids.emplace_back(keyword.position, std::move(*keyword.retailer_p_id));
+			}
+			if (keyword.is_paid) {
+				ranked.paid[bit / 64] |= uint64_t(1) << (bit % 64);
+			}
+		}
+		begin = end;
+	}
+	keywords.clear();
+}
+
+void SearchRankedFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<SearchGlobalState>();
+	auto &local_state = data.local_state->Cast<SearchRankedLocalState>();
+
+	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+
+		const auto keyword_id = global_state.KeywordId(range_idx);
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		const auto rows_before = local_state.remainder.size();
+
+		global_state.reader.Read(range, global_state.filter, local_state.profile, [&](const cbt::Row &row) {
+			DecodeRow(keyword_id, row, local_state.keyword_slots, local_state.profile);
+			local_state.keyword_slots.Drain(local_state.keywords);
+			RankHours(local_state.keywords, local_state.remainder);
+		});
+		global_state.rows_read.fetch_add(local_state.remainder.size() - rows_before, std::memory_order_relaxed);
+		global_state.ranges_read.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const idx_t count = std::min((idx_t)STANDARD_VECTOR_SIZE, local_state.remainder.size() - local_state.remainder_idx);
+
+	if (count == 0) {
+		output.SetCardinality(0);
+		local_state.remainder_idx = 0;
+		local_state.remainder.clear();
+		return;
+	}
+
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
+	const auto *hours = &local_state.remainder[local_state.remainder_idx];
+
+	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+		auto &out_vec = output.data[col_idx];
+		const auto column_id = global_state.column_ids[col_idx];
+
+		switch (static_cast<RankedColumn>(column_id)) {
+		case RankedColumn::KEYWORD_ID: {
+			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = hours[i].keyword_id;
+			}
+			break;
+		}
+		case RankedColumn::SHOP_ID: {
+			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = hours[i].shop_id;
+			}
+			break;
+		}
+		case RankedColumn::DATE: {
+			auto *data_ptr = FlatVector::GetData<timestamp_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = timestamp_t(Timestamp::GetEpochSeconds(hours[i].date));
+			}
+			break;
+		}
+		case RankedColumn::PE_IDS: {
+			auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
+			idx_t total = 0;
+			for (idx_t i = 0; i < count; i++) total += hours[i].pe_ids.size();
+			ListVector::Reserve(out_vec, total);
+			auto &child = ListVector::GetEntry(out_vec);
+			auto *child_data = FlatVector::GetData<uint64_t>(child);
+			auto &child_validity = FlatVector::Validity(child);
+			idx_t offset = 0;
+			for (idx_t i = 0; i < count; i++) {
+				list_data[i] = {offset, hours[i].pe_ids.size()};
+				for (const auto &pe_id : hours[i].pe_ids) {
+					if (pe_id) {
+						child_data[offset] = *pe_id;
+					} else {
+						child_validity.SetInvalid(offset);
+					}
+					offset++;
+				}
+			}
+			ListVector::SetListSize(out_vec, total);
+			break;
+		}
+		case RankedColumn::RETAILER_P_IDS: {
+			// Aligned with pe_ids, so that the rank of a result is its list index in either column
+			auto *list_data = FlatVector::GetData<list_entry_t>(out_vec);
+			idx_t total = 0;
+			for (idx_t i = 0; i < count; i++) total += hours[i].pe_ids.size();
+			ListVector::Reserve(out_vec, total);
+			auto &child = ListVector::GetEntry(out_vec);
+			auto *child_data = FlatVector::GetData<string_t>(child);
+			auto &child_validity = FlatVector::Validity(child);
+			idx_t offset = 0;
+			for (idx_t i = 0; i < count; i++) {
+				const auto length = hours[i].pe_ids.size();
+				list_data[i] = {offset, length};
+				for (idx_t j = 0; j < length; j++) {
+					child_validity.SetInvalid(offset + j);
+				}
+				for (const auto &retailer : hours[i].retailer_p_ids) {
+					child_data[offset + retailer.first - 1] = StringVector::AddString(child, retailer.second);
+					child_validity.SetValid(offset + retailer.first - 1);
+				}
+				offset += length;
+			}
+			ListVector::SetListSize(out_vec, total);
+			break;
+		}
+		case RankedColumn::PAID: {
+			auto *data_ptr = FlatVector::GetData<string_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				auto bits = StringVector::EmptyString(out_vec, Bit::ComputeBitstringLen(MAX_POSITION));
+				Bit::SetEmptyBitString(bits, MAX_POSITION);
+				for (idx_t word_idx = 0; word_idx < PAID_WORDS; word_idx++) {
+					for (auto word = hours[i].paid[word_idx]; word; word &= word - 1) {
+						Bit::SetBit(bits, word_idx * 64 + std::countr_zero(word), 1);
+					}
+				}
+				bits.Finalize();
+				data_ptr[i] = bits;
+			}
+			break;
+		}
+		}
+	}
+
+	local_state.remainder_idx += count;
+	output.SetCardinality(count);
+}
+
+unique_ptr<NodeStatistics> SearchRankedCardinality(ClientContext &context, const FunctionData *bind_data) {
+	// A point range holds at most one ranked list per hour of its week
+	return EstimateRows(bind_data->Cast<SearchFunctionData>(), 7 * 24);
 }
 
 unique_ptr<BaseStatistics> SearchStatistics(ClientContext &context, const FunctionData *bind_data,
@@ -323,11 +753,21 @@ unique_ptr<BaseStatistics> SearchStatistics(ClientContext &context, const Functi
 	case SearchColumn::DATE: {
 		auto stats = BaseStatistics::CreateUnknown(LogicalType::TIMESTAMP_S);
 		stats.SetHasNoNullFast();
+		// Point ranges only read the row of the first week
+		const auto last_week = data.shop_ids.empty() ? data.week_end : data.week_start;
+		if (WeekCount(data.week_start, last_week) > 0) {
+			const int64_t first_second = Date::Epoch(WeekStart(data.week_start));
+			const int64_t last_second = Date::Epoch(WeekStart(last_week) + 7) - 1;
+			NumericStats::SetMin(stats, Value::TIMESTAMPSEC(timestamp_sec_t(first_second)));
+			NumericStats::SetMax(stats, Value::TIMESTAMPSEC(timestamp_sec_t(last_second)));
+		}
 		return make_uniq<BaseStatistics>(std::move(stats));
 	}
 	case SearchColumn::POSITION: {
 		auto stats = BaseStatistics::CreateUnknown(LogicalType::UTINYINT);
 		stats.SetHasNoNullFast();
+		NumericStats::SetMin(stats, Value::UTINYINT(1));
+		NumericStats::SetMax(stats, Value::UTINYINT(MAX_POSITION));
 		return make_uniq<BaseStatistics>(std::move(stats));
 	}
 	case SearchColumn::IS_PAID: {
@@ -0,0 +1,334 @@
+#include "search_agg.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "keys.hpp"
+#include "profile.hpp"
+#include "range_reader.hpp"
+#include "range_scheduler.hpp"
+#include "utils.hpp"
+
+#include <bit>
+#include <google/cloud/bigtable/table.h>
+#include <string_view>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+enum SearchAggColumn : column_t {
+	KEYWORD_ID = 0,
+	SHOP_ID = 1,
+	DATE = 2,
+	RESULTS = 3,
+	PE_RESULTS = 4,
+	RETAILER_RESULTS = 5,
+	PAID = 6,
+	PAID_SHARE = 7
+};
+constexpr uint8_t MAX_POSITION = 200;
+
+// The rollup of the results of a keyword in a shop over one day, counted once per hour and position
+struct DayRollup {
+	uint32_t keyword_id;
+	uint32_t shop_id;
+	date_t date;
+	uint64_t results;
+	uint64_t pe_results;
+	uint64_t retailer_results;
+	uint64_t paid;
+};
+
+// The results of one row as bitmaps over the hour of the week and position, the slots of search. A day is a whole
+// number of words, so the results of a day are counted with popcounts instead of being materialized.
+struct ResultBitmaps {
+	static constexpr idx_t SLOTS_PER_DAY = 24 * MAX_POSITION;
+	static_assert(SLOTS_PER_DAY % 64 == 0, "a day of slots must be a whole number of words");
+	static constexpr idx_t WORDS_PER_DAY = SLOTS_PER_DAY / 64;
+	static constexpr idx_t WORDS = 7 * WORDS_PER_DAY;
+
+	std::array<uint64_t, WORDS> occupied {};
+	std::array<uint64_t, WORDS> pe {};
+	std::array<uint64_t, WORDS> retailer {};
+	std::array<uint64_t, WORDS> paid {};
+
+	static void Set(std::array<uint64_t, WORDS> &bitmap, uint32_t slot) {
+		bitmap[slot / 64] |= uint64_t(1) << (slot % 64);
+	}
+
+	static uint64_t CountDay(const std::array<uint64_t, WORDS> &bitmap, idx_t day) {
+		uint64_t count = 0;
+		for (idx_t word_idx = day * WORDS_PER_DAY; word_idx < (day + 1) * WORDS_PER_DAY; word_idx++) {
+			count += std::popcount(bitmap[word_idx]);
+		}
+		return count;
+	}
+
+	void Clear() {
+		occupied.fill(0);
+		pe.fill(0);
+		retailer.fill(0);
+		paid.fill(0);
+	}
+};
+
+struct SearchAggFunctionData : TableFunctionData {
+	BigtableConfig config;
+	vector<uint32_t> keyword_ids;
+	vector<cbt::RowRange> ranges;
+};
+
+unique_ptr<FunctionData> SearchAggFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                               vector<LogicalType> &return_types, vector<string> &names) {
+	names = {"keyword_id", "shop_id", "date", "results", "pe_results", "retailer_results", "paid", "paid_share"};
+	return_types = {LogicalType::UINTEGER, LogicalType::UINTEGER, LogicalType::DATE,    LogicalType::UBIGINT,
+	                LogicalType::UBIGINT,  LogicalType::UBIGINT,  LogicalType::UBIGINT, LogicalType::DOUBLE};
+
+	auto bind_data = make_uniq<SearchAggFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, BigtableConfig::GetTableId(context, "search"));
+	const auto week_start = std::to_string(IntegerValue::Get(input.inputs[0]));
+	const auto week_end = std::to_string(IntegerValue::Get(input.inputs[1]));
+	const auto &ls_keyword_id = ListValue::GetChildren(input.inputs[2]);
+
+	vector<string> prefix_ids;
+	prefix_ids.reserve(ls_keyword_id.size());
+	bind_data->keyword_ids.reserve(ls_keyword_id.size());
+	for (const auto &p : ls_keyword_id) {
+		const auto keyword_id = IntegerValue::Get(p);
+		bind_data->keyword_ids.emplace_back(keyword_id);
+		prefix_ids.emplace_back(ReverseId(keyword_id));
+	}
+
+	// Ranges are laid out like those of search, shop by shop when shops are given
+	if (input.inputs.size() == 4) {
+		const auto &ls_shop_id = ListValue::GetChildren(input.inputs[3]);
+		bind_data->ranges.reserve(prefix_ids.size() * ls_shop_id.size());
+		for (const auto &s : ls_shop_id) {
+			const auto shop_id = std::to_string(IntegerValue::Get(s));
+			for (const auto &p : prefix_ids) {
+				const auto row_key = p + "/" + week_start + "/" + shop_id;
+				bind_data->ranges.emplace_back(cbt::RowRange::Closed(row_key, row_key));
+			}
+		}
+	} else {
+		bind_data->ranges.reserve(prefix_ids.size());
+		for (const auto &p : prefix_ids) {
+			bind_data->ranges.emplace_back(cbt::RowRange::Closed(p + "/" + week_start + "/", p + "/" + week_end + "0"));
+		}
+	}
+
+	return bind_data;
+}
+
+struct SearchAggGlobalState : GlobalTableFunctionState {
+	// Both families are needed, results are counted on either and paid ones on s
+	const cbt::Filter filter;
+	RangeReader reader;
+	RangeScheduler scheduler;
+	const idx_t max_inflight;
+	const vector<uint32_t> keyword_ids;
+	const vector<column_t> column_ids;
+	ScanProfiles profiles;
+
+	SearchAggGlobalState(const BigtableConfig &config, vector<uint32_t> keyword_ids_p, vector<cbt::RowRange> ranges_p,
+	                     vector<column_t> column_ids_p)
+	    : filter(cbt::Filter::PassAllFilter()), reader(config), scheduler(std::move(ranges_p)),
+	      max_inflight(config.max_inflight), keyword_ids(std::move(keyword_ids_p)), column_ids(std::move(column_ids_p)), profiles(config) {};
+
+	idx_t MaxThreads() const override {
+		return MinValue(scheduler.MaxThreads(), max_inflight);
+	}
+};
+
+unique_ptr<GlobalTableFunctionState> SearchAggInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<SearchAggFunctionData>();
+	return make_uniq<SearchAggGlobalState>(bind_data.config, std::move(bind_data.keyword_ids),
+	                                       std::move(bind_data.ranges), std::move(input.column_ids));
+}
+
+struct SearchAggLocalState : LocalTableFunctionState {
+	ScanProfile &profile;
+	idx_t remainder_idx = 0;
+	vector<DayRollup> remainder;
+	ResultBitmaps bitmaps;
+
+	explicit SearchAggLocalState(ScanProfile &profile_p) : profile(profile_p) {};
+};
+
+unique_ptr<LocalTableFunctionState> SearchAggInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                       GlobalTableFunctionState *global_state) {
+	return make_uniq<SearchAggLocalState>(global_state->Cast<SearchAggGlobalState>().profiles.Register());
+}
+
+// A row holds a keyword in a shop for a whole week, so its days are complete rollups on their own
+static void RollUpRow(SearchAggLocalState &local_state, uint32_t keyword_id, const cbt::Row &row) {
+	const std::string_view row_key = row.row_key();
+	const auto week_begin = row_key.find('/') + 1;
+	const auto week_sep = row_key.find('/', week_begin);
+	const auto week_opt = ParseInt32(row_key.substr(week_begin, week_sep - week_begin));
+	const auto shop_id_opt = ParseUint32(row_key.substr(row_key.find_last_of('/') + 1));
+	if (!week_opt || !shop_id_opt) {
+		ScanProfile::Add(local_state.profile.filtered, 1);
+		return;
+	}
+
+	auto &bitmaps = local_state.bitmaps;
+	for (const auto &cell : row.cells()) {
+		const auto position_opt = ParseUint8(cell.column_qualifier());
+		if (!position_opt || *position_opt == 0 || *position_opt > MAX_POSITION) {
+			ScanProfile::Add(local_state.profile.filtered, 1);
+			continue;
+		}
+		const std::string_view value = cell.value();
+		if (value.starts_with("id_ret_pos_")) {
+			ScanProfile::Add(local_state.profile.filtered, 1);
+			continue;
+		}
+
+		const timestamp_t timestamp = Timestamp::FromEpochMicroSeconds(cell.timestamp().count());
+		const int32_t weekday = Date::ExtractISODayOfTheWeek(Timestamp::GetDate(timestamp)) - 1;
+		const int32_t hour = Timestamp::GetTime(timestamp).micros / 3'600'000'000;
+		const uint32_t slot = (weekday * 24 + hour) * MAX_POSITION + *position_opt - 1;
+
+		ResultBitmaps::Set(bitmaps.occupied, slot);
+		switch (cell.family_name()[0]) {
+		case 'p':
+			if (value.starts_with("id_ret_")) {
+				ResultBitmaps::Set(bitmaps.retailer, slot);
+			} else if (ParseUint64(value)) {
+				ResultBitmaps::Set(bitmaps.pe, slot);
+			}
+			break;
+		case 's':
+			ResultBitmaps::Set(bitmaps.paid, slot);
+			break;
+		}
+	}
+
+	const auto monday = WeekStart(*week_opt);
+	for (idx_t day = 0; day < 7; day++) {
+		const auto results = ResultBitmaps::CountDay(bitmaps.occupied, day);
+		if (results == 0) {
+			continue;
+		}
+		local_state.remainder.push_back(DayRollup {keyword_id, *shop_id_opt, monday + static_cast<int32_t>(day),
+		                                           results, ResultBitmaps::CountDay(bitmaps.pe, day),
+		                                           ResultBitmaps::CountDay(bitmaps.retailer, day),
+		                                           ResultBitmaps::CountDay(bitmaps.paid, day)});
+	}
+	bitmaps.Clear();
+}
+
+void SearchAggFunction(ClientContext &context, TableFunctionInput &data, DataChunk &output) {
+	auto &global_state = data.global_state->Cast<SearchAggGlobalState>();
+	auto &local_state = data.local_state->Cast<SearchAggLocalState>();
+
+	if (local_state.remainder_idx == local_state.remainder.size()) {
+		local_state.remainder_idx = 0;
+		local_state.remainder.clear();
+	}
+	while ((local_state.remainder.size() - local_state.remainder_idx) < STANDARD_VECTOR_SIZE) {
+		idx_t range_idx;
+		if (!global_state.scheduler.Next(range_idx)) {
+			break;
+		}
+
+		// Ranges are laid out shop by shop, each covering every keyword_id in order
+		const auto keyword_id = global_state.keyword_ids[range_idx % global_state.keyword_ids.size()];
+		const auto &range = global_state.scheduler.ranges[range_idx];
+		global_state.reader.Read(range, global_state.filter, local_state.profile,
+		                         [&](const cbt::Row &row) { RollUpRow(local_state, keyword_id, row); });
+	}
+
+	const idx_t count =
+	    MinValue<idx_t>(STANDARD_VECTOR_SIZE, local_state.remainder.size() - local_state.remainder_idx);
+	if (count == 0) {
+		output.SetCardinality(0);
+		return;
+	}
+
+	ProfileTimer emit_timer(local_state.profile.emit_ns);
+	const auto *rollups = &local_state.remainder[local_state.remainder_idx];
+
+	for (idx_t col_idx = 0; col_idx < global_state.column_ids.size(); col_idx++) {
+		auto &out_vec = output.data[col_idx];
+
+		switch (static_cast<SearchAggColumn>(global_state.column_ids[col_idx])) {
+		case SearchAggColumn::KEYWORD_ID: {
+			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].keyword_id;
+			}
+			break;
+		}
+		case SearchAggColumn::SHOP_ID: {
+			auto data_ptr = FlatVector::GetData<uint32_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].shop_id;
+			}
+			break;
+		}
+		case SearchAggColumn::DATE: {
+			auto data_ptr = FlatVector::GetData<date_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].date;
+			}
+			break;
+		}
+		case SearchAggColumn::RESULTS: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].results;
+			}
+			break;
+		}
+		case SearchAggColumn::PE_RESULTS: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].pe_results;
+			}
+			break;
+		}
+		case SearchAggColumn::RETAILER_RESULTS: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].retailer_results;
+			}
+			break;
+		}
+		case SearchAggColumn::PAID: {
+			auto data_ptr = FlatVector::GetData<uint64_t>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = rollups[i].paid;
+			}
+			break;
+		}
+		case SearchAggColumn::PAID_SHARE: {
+			auto data_ptr = FlatVector::GetData<double>(out_vec);
+			for (idx_t i = 0; i < count; i++) {
+				data_ptr[i] = static_cast<double>(rollups[i].paid) / static_cast<double>(rollups[i].results);
+			}
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	local_state.remainder_idx += count;
+	output.SetCardinality(count);
+}
+
+double SearchAggScanProgress(ClientContext &context, const FunctionData *bind_data,
+                             const GlobalTableFunctionState *global_state) {
+	return global_state->Cast<SearchAggGlobalState>().scheduler.Progress();
+}
+
+InsertionOrderPreservingMap<string> SearchAggDynamicToString(TableFunctionDynamicToStringInput &input) {
+	if (!input.global_state) {
+		return {};
+	}
+	return input.global_state->Cast<SearchAggGlobalState>().profiles.ToMap();
+}
+
+} // namespace duckdb
@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <optional>
 #include <charconv>
+#include <string>
 #include <string_view>
 
 std::optional<uint8_t> ParseUint8(std::string_view s) {
@@ -42,6 +43,24 @@ std::optional<uint64_t> ParseUint64(std::string_view s) {
 	return std::nullopt;
 }
 
+std::optional<int32_t> ParseInt32(std::string_view s) {
+	int32_t result;
+	auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+	if (ec == std::errc()) {
+		return result;
+	}
+	return std::nullopt;
+}
+
+std::optional<int64_t> ParseInt64(std::string_view s) {
+	int64_t result;
+	auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), result);
+	if (ec == std::errc()) {
+		return result;
+	}
+	return std::nullopt;
+}
+
 std::optional<float> ParseFloat(std::string_view s) {
 	float result;
 	auto [ptr, ec] = duckdb_fast_float::from_chars(s.data(), s.data() + s.size(), result);
@@ -50,3 +69,18 @@ std::optional<float> ParseFloat(std::string_view s) {
 	}
 	return std::nullopt;
 }
+
+std::optional<double> ParseDouble(std::string_view s) {
+	double result;
+	auto [ptr, ec] = duckdb_fast_float::from_chars(s.data(), s.data() + s.size(), result);
+	if (ec == std::errc()) {
+		return result;
+	}
+	return std::nullopt;
+}
+
+std::string FormatFloat(float value) {
+	char buffer[32];
+	auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	return std::string(buffer, ptr);
+}
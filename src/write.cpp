@@ -0,0 +1,404 @@
+#include "write.hpp"
+
+#include "config.hpp"
+#include "duckdb.hpp"
+#include "keys.hpp"
+#include "utils.hpp"
+
+#include <deque>
+#include <google/cloud/bigtable/table.h>
+#include <optional>
+#include <unordered_map>
+
+namespace cbt = ::google::cloud::bigtable;
+
+namespace duckdb {
+
+enum class WriteLayout : uint8_t { PRODUCT, SEARCH };
+
+// Input columns of each layout, named and typed like the output of the matching scan so that
+// `bigtable_write((FROM product(...)), 'product')` round-trips.
+struct ProductWriteColumn {
+	enum : idx_t {
+		PE_ID = 0,
+		SHOP_ID = 1,
+		DATE = 2,
+		PRICE = 3,
+		BASE_PRICE = 4,
+		UNIT_PRICE = 5,
+		PROMO_ID = 6,
+		PROMO_TEXT = 7,
+		SHELF_ID = 8,
+		POSITION = 9,
+		IS_PAID = 10
+	};
+};
+
+struct SearchWriteColumn {
+	enum : idx_t { KEYWORD_ID = 0, SHOP_ID = 1, DATE = 2, POSITION = 3, PE_ID = 4, RETAILER_P_ID = 5, IS_PAID = 6 };
+};
+
+struct WriteFunctionData : TableFunctionData {
+	BigtableConfig config;
+	WriteLayout layout;
+	vector<LogicalType> types;
+	// Input column of each layout column, DConstants::INVALID_INDEX when the input does not provide it
+	vector<idx_t> input_idx;
+	idx_t batch_size = 1000;
+	idx_t max_inflight = 4;
+};
+
+static void GetLayoutColumns(WriteLayout layout, vector<string> &names, vector<LogicalType> &types,
+                             idx_t &required) {
+	switch (layout) {
+	case WriteLayout::PRODUCT:
+		names = {"pe_id",    "shop_id",    "date",     "price",    "base_price", "unit_price",
+		         "promo_id", "promo_text", "shelf_id", "position", "is_paid"};
+		types = {LogicalType::UBIGINT,
+		         LogicalType::UINTEGER,
+		         LogicalType::DATE,
+		         LogicalType::FLOAT,
+		         LogicalType::FLOAT,
+		         LogicalType::FLOAT,
+		         LogicalType::UINTEGER,
+		         LogicalType::VARCHAR,
+		         LogicalType::LIST(LogicalType::VARCHAR),
+		         LogicalType::LIST(LogicalType::USMALLINT),
+		         LogicalType::LIST(LogicalType::BOOLEAN)};
+		required = 3;
+		break;
+	case WriteLayout::SEARCH:
+		names = {"keyword_id", "shop_id", "date", "position", "pe_id", "retailer_p_id", "is_paid"};
+		types = {LogicalType::UINTEGER, LogicalType::UINTEGER, LogicalType::TIMESTAMP, LogicalType::UTINYINT,
+		         LogicalType::UBIGINT,  LogicalType::VARCHAR,  LogicalType::BOOLEAN};
+		required = 4;
+		break;
+	}
+}
+
+unique_ptr<FunctionData> WriteFunctionBind(ClientContext &context, TableFunctionBindInput &input,
+                                           vector<LogicalType> &return_types, vector<string> &names) {
+	auto bind_data = make_uniq<WriteFunctionData>();
+	bind_data->config = BigtableConfig::Get(context, StringValue::Get(input.inputs[0]));
+
+	string layout = bind_data->config.table_id;
+	for (const auto &param : input.named_parameters) {
+		if (param.first == "layout") {
+			layout = StringValue::Get(param.second);
+		} else if (param.first == "batch_size") {
+			bind_data->batch_size = UBigIntValue::Get(param.second);
+		} else if (param.first == "max_inflight") {
+			bind_data->max_inflight = UBigIntValue::Get(param.second);
+		}
+	}
+	if (bind_data->batch_size == 0 || bind_data->max_inflight == 0) {
+		throw BinderException("bigtable_write: batch_size and max_inflight must be positive");
+	}
+
+	if (layout == "product") {
+		bind_data->layout = WriteLayout::PRODUCT;
+	} else if (layout == "search") {
+		bind_data->layout = WriteLayout::SEARCH;
+	} else {
+		throw BinderException("bigtable_write: unknown layout \"%s\", expected \"product\" or \"search\"", layout);
+	}
+
+	vector<string> layout_names;
+	idx_t required;
+	GetLayoutColumns(bind_data->layout, layout_names, bind_data->types, required);
+
+	bind_data->input_idx.assign(layout_names.size(), DConstants::INVALID_INDEX);
+	for (idx_t i = 0; i < input.input_table_names.size(); i++) {
+		for (idx_t col = 0; col < layout_names.size(); col++) {
+			if (StringUtil::CIEquals(input.input_table_names[i], layout_names[col])) {
+				bind_data->input_idx[col] = i;
+			}
+		}
+	}
+	for (idx_t col = 0; col < required; col++) {
+		if (bind_data->input_idx[col] == DConstants::INVALID_INDEX) {
+			throw BinderException("bigtable_write: input is missing the \"%s\" column", layout_names[col]);
+		}
+	}
+	if (bind_data->layout == WriteLayout::PRODUCT) {
+		const bool has_shelf_id = bind_data->input_idx[ProductWriteColumn::SHELF_ID] != DConstants::INVALID_INDEX;
+		const bool has_position = bind_data->input_idx[ProductWriteColumn::POSITION] != DConstants::INVALID_INDEX;
+		if (has_shelf_id != has_position) {
+			throw BinderException("bigtable_write: shelf_id and position must be provided together");
+		}
+	}
+
+	names = {"rows_written", "rows_skipped"};
+	return_types = {LogicalType::UBIGINT, LogicalType::UBIGINT};
+	return bind_data;
+}
+
+struct WriteGlobalState : GlobalTableFunctionState {
+	cbt::Table table;
+
+	explicit WriteGlobalState(const BigtableConfig &config) : table(config.MakeTable()) {};
+};
+
+unique_ptr<GlobalTableFunctionState> WriteInitGlobal(ClientContext &context, TableFunctionInitInput &input) {
+	auto &bind_data = input.bind_data->Cast<WriteFunctionData>();
+	return make_uniq<WriteGlobalState>(bind_data.config);
+}
+
+// MutateRows rejects requests with more than 100k cells in total
+static constexpr idx_t MAX_BATCH_CELLS = 100000;
+
+struct PendingBatch {
+	// Input rows grouped into each mutation, to report rows_written
+	vector<idx_t> input_rows;
+	google::cloud::future<std::vector<cbt::FailedMutation>> result;
+};
+
+struct WriteLocalState : LocalTableFunctionState {
+	// Tables are not safe to share between threads, copies share the underlying connection
+	cbt::Table table;
+	DataChunk cast_chunk;
+	// One mutation per row key, cells of input rows sharing a row key are appended to the same mutation
+	vector<cbt::SingleRowMutation> batch;
+	vector<idx_t> batch_rows;
+	std::unordered_map<string, idx_t> batch_index;
+	idx_t batch_cells = 0;
+	std::deque<PendingBatch> inflight;
+	idx_t rows_written = 0;
+	// Input rows without any cell to write, which MutateRows would reject
+	idx_t rows_skipped = 0;
+
+	explicit WriteLocalState(cbt::Table table_p) : table(std::move(table_p)) {};
+};
+
+unique_ptr<LocalTableFunctionState> WriteInitLocal(ExecutionContext &context, TableFunctionInitInput &input,
+                                                   GlobalTableFunctionState *global_state) {
+	auto &bind_data = input.bind_data->Cast<WriteFunctionData>();
+	auto local_state = make_uniq<WriteLocalState>(global_state->Cast<WriteGlobalState>().table);
+	local_state->cast_chunk.Initialize(Allocator::Get(context.client), bind_data.types);
+	local_state->batch.reserve(bind_data.batch_size);
+	local_state->batch_rows.reserve(bind_data.batch_size);
+	return local_state;
+}
+
+static void SendBatch(WriteLocalState &local_state, vector<cbt::SingleRowMutation> mutations,
+                      vector<idx_t> input_rows) {
+	cbt::BulkMutation bulk(std::make_move_iterator(mutations.begin()), std::make_move_iterator(mutations.end()));
+	auto result = local_state.table.AsyncBulkApply(std::move(bulk));
+	local_state.inflight.push_back(PendingBatch {std::move(input_rows), std::move(result)});
+}
+
+// Waits for the oldest batch in flight. Transient failures were already retried by the client's retry policy
+// within bigtable_timeout_ms, so a mutation that still failed fails the write.
+static void CompleteBatch(WriteLocalState &local_state) {
+	auto pending = std::move(local_state.inflight.front());
+	local_state.inflight.pop_front();
+
+	const auto failures = pending.result.get();
+	if (!failures.empty()) {
+		throw std::runtime_error(failures.front().status().message());
+	}
+	for (const auto rows : pending.input_rows) {
+		local_state.rows_written += rows;
+	}
+}
+
+static void FlushBatch(WriteLocalState &local_state, const WriteFunctionData &bind_data) {
+	if (!local_state.batch.empty()) {
+		SendBatch(local_state, std::move(local_state.batch), std::move(local_state.batch_rows));
+		local_state.batch.clear();
+		local_state.batch.reserve(bind_data.batch_size);
+		local_state.batch_rows.clear();
+		local_state.batch_rows.reserve(bind_data.batch_size);
+		local_state.batch_index.clear();
+		local_state.batch_cells = 0;
+	}
+	while (local_state.inflight.size() > bind_data.max_inflight) {
+		CompleteBatch(local_state);
+	}
+}
+
+// Adds the cells of one input row to the mutation of its row key, batch_size counts row keys rather than input rows.
+static void AddCells(WriteLocalState &local_state, const WriteFunctionData &bind_data, string row_key,
+                     vector<cbt::Mutation> &cells) {
+	if (cells.empty()) {
+		local_state.rows_skipped++;
+		return;
+	}
+	if (local_state.batch_cells + cells.size() > MAX_BATCH_CELLS) {
+		FlushBatch(local_state, bind_data);
+	}
+	local_state.batch_cells += cells.size();
+
+	auto entry = local_state.batch_index.find(row_key);
+	if (entry == local_state.batch_index.end()) {
+		entry = local_state.batch_index.emplace(row_key, local_state.batch.size()).first;
+		local_state.batch.emplace_back(std::move(row_key));
+		local_state.batch_rows.push_back(0);
+	}
+	auto &mutation = local_state.batch[entry->second];
+	for (auto &cell : cells) {
+		mutation.emplace_back(std::move(cell));
+	}
+	cells.clear();
+	local_state.batch_rows[entry->second]++;
+
+	if (local_state.batch.size() >= bind_data.batch_size) {
+		FlushBatch(local_state, bind_data);
+	}
+}
+
+template <class T>
+static std::optional<T> ReadValue(const UnifiedVectorFormat &format, idx_t row) {
+	const auto idx = format.sel->get_index(row);
+	if (!format.validity.RowIsValid(idx)) {
+		return std::nullopt;
+	}
+	return UnifiedVectorFormat::GetData<T>(format)[idx];
+}
+
+static void EncodeProducts(WriteLocalState &local_state, const WriteFunctionData &bind_data,
+                           const vector<UnifiedVectorFormat> &formats, idx_t count) {
+	auto &chunk = local_state.cast_chunk;
+	const bool has_shelves = bind_data.input_idx[ProductWriteColumn::SHELF_ID] != DConstants::INVALID_INDEX;
+	const bool has_is_paid = bind_data.input_idx[ProductWriteColumn::IS_PAID] != DConstants::INVALID_INDEX;
+
+	UnifiedVectorFormat shelf_format, position_format, is_paid_format;
+	if (has_shelves) {
+		auto &shelf_vec = chunk.data[ProductWriteColumn::SHELF_ID];
+		auto &position_vec = chunk.data[ProductWriteColumn::POSITION];
+		ListVector::GetEntry(shelf_vec).ToUnifiedFormat(ListVector::GetListSize(shelf_vec), shelf_format);
+		ListVector::GetEntry(position_vec).ToUnifiedFormat(ListVector::GetListSize(position_vec), position_format);
+	}
+	if (has_is_paid) {
+		auto &is_paid_vec = chunk.data[ProductWriteColumn::IS_PAID];
+		ListVector::GetEntry(is_paid_vec).ToUnifiedFormat(ListVector::GetListSize(is_paid_vec), is_paid_format);
+	}
+
+	vector<cbt::Mutation> cells;
+	for (idx_t i = 0; i < count; i++) {
+		const auto pe_id = ReadValue<uint64_t>(formats[ProductWriteColumn::PE_ID], i);
+		const auto shop_id = ReadValue<uint32_t>(formats[ProductWriteColumn::SHOP_ID], i);
+		const auto date = ReadValue<date_t>(formats[ProductWriteColumn::DATE], i);
+		if (!pe_id || !shop_id || !date) {
+			throw InvalidInputException("bigtable_write: pe_id, shop_id and date cannot be NULL");
+		}
+
+		const auto timestamp = std::chrono::milliseconds(Date::EpochMicroseconds(*date) / 1000);
+
+		if (const auto price = ReadValue<float>(formats[ProductWriteColumn::PRICE], i)) {
+			cells.emplace_back(cbt::SetCell("p", "p", timestamp, FormatFloat(*price)));
+		}
+		if (const auto base_price = ReadValue<float>(formats[ProductWriteColumn::BASE_PRICE], i)) {
+			cells.emplace_back(cbt::SetCell("p", "b", timestamp, FormatFloat(*base_price)));
+		}
+		if (const auto unit_price = ReadValue<float>(formats[ProductWriteColumn::UNIT_PRICE], i)) {
+			cells.emplace_back(cbt::SetCell("p", "u", timestamp, FormatFloat(*unit_price)));
+		}
+		if (const auto promo_id = ReadValue<uint32_t>(formats[ProductWriteColumn::PROMO_ID], i)) {
+			const auto promo_text = ReadValue<string_t>(formats[ProductWriteColumn::PROMO_TEXT], i);
+			cells.emplace_back(cbt::SetCell("d", std::to_string(*promo_id), timestamp,
+			                                   promo_text ? promo_text->GetString() : string()));
+		}
+
+		if (has_shelves) {
+			const auto shelves = ReadValue<list_entry_t>(formats[ProductWriteColumn::SHELF_ID], i);
+			const auto positions = ReadValue<list_entry_t>(formats[ProductWriteColumn::POSITION], i);
+			const auto is_paid = has_is_paid ? ReadValue<list_entry_t>(formats[ProductWriteColumn::IS_PAID], i)
+			                                 : std::nullopt;
+			if (shelves && positions) {
+				const auto length = MinValue(shelves->length, positions->length);
+				for (idx_t j = 0; j < length; j++) {
+					const auto shelf = ReadValue<string_t>(shelf_format, shelves->offset + j);
+					const auto position = ReadValue<uint16_t>(position_format, positions->offset + j);
+					if (!shelf || !position) {
+						continue;
+					}
+					const bool paid = is_paid && j < is_paid->length &&
+					                  ReadValue<bool>(is_paid_format, is_paid->offset + j).value_or(false);
+					cells.emplace_back(
+					    cbt::SetCell(paid ? "S" : "s", shelf->GetString(), timestamp, std::to_string(*position)));
+				}
+			}
+		}
+
+		AddCells(local_state, bind_data, MakeRowKey(*pe_id, WeekKey(*date), *shop_id), cells);
+	}
+}
+
+static void EncodeSearches(WriteLocalState &local_state, const WriteFunctionData &bind_data,
+                           const vector<UnifiedVectorFormat> &formats, idx_t count) {
+	vector<cbt::Mutation> cells;
+	for (idx_t i = 0; i < count; i++) {
+		const auto keyword_id = ReadValue<uint32_t>(formats[SearchWriteColumn::KEYWORD_ID], i);
+		const auto shop_id = ReadValue<uint32_t>(formats[SearchWriteColumn::SHOP_ID], i);
+		const auto date = ReadValue<timestamp_t>(formats[SearchWriteColumn::DATE], i);
+		const auto position = ReadValue<uint8_t>(formats[SearchWriteColumn::POSITION], i);
+		if (!keyword_id || !shop_id || !date || !position) {
+			throw InvalidInputException("bigtable_write: keyword_id, shop_id, date and position cannot be NULL");
+		}
+
+		const auto timestamp = std::chrono::milliseconds(Timestamp::GetEpochMs(*date));
+		const auto qualifier = std::to_string(*position);
+
+		if (const auto pe_id = ReadValue<uint64_t>(formats[SearchWriteColumn::PE_ID], i)) {
+			cells.emplace_back(cbt::SetCell("p", qualifier, timestamp, std::to_string(*pe_id)));
+		} else if (const auto retailer_p_id = ReadValue<string_t>(formats[SearchWriteColumn::RETAILER_P_ID], i)) {
+			cells.emplace_back(cbt::SetCell("p", qualifier, timestamp, "id_ret_" + retailer_p_id->GetString()));
+		}
+		if (ReadValue<bool>(formats[SearchWriteColumn::IS_PAID], i).value_or(false)) {
+			cells.emplace_back(cbt::SetCell("s", qualifier, timestamp, "1"));
+		}
+
+		AddCells(local_state, bind_data, MakeRowKey(*keyword_id, WeekKey(Timestamp::GetDate(*date)), *shop_id), cells);
+	}
+}
+
+OperatorResultType WriteFunction(ExecutionContext &context, TableFunctionInput &data, DataChunk &input,
+                                 DataChunk &output) {
+	const auto &bind_data = data.bind_data->Cast<WriteFunctionData>();
+	auto &local_state = data.local_state->Cast<WriteLocalState>();
+	auto &chunk = local_state.cast_chunk;
+	const idx_t count = input.size();
+
+	chunk.Reset();
+	vector<UnifiedVectorFormat> formats(chunk.ColumnCount());
+	for (idx_t col = 0; col < chunk.ColumnCount(); col++) {
+		const auto input_idx = bind_data.input_idx[col];
+		if (input_idx == DConstants::INVALID_INDEX) {
+			chunk.data[col].Reference(Value(bind_data.types[col]));
+		} else {
+			VectorOperations::Cast(context.client, input.data[input_idx], chunk.data[col], count);
+		}
+		chunk.data[col].ToUnifiedFormat(count, formats[col]);
+	}
+	chunk.SetCardinality(count);
+
+	switch (bind_data.layout) {
+	case WriteLayout::PRODUCT:
+		EncodeProducts(local_state, bind_data, formats, count);
+		break;
+	case WriteLayout::SEARCH:
+		EncodeSearches(local_state, bind_data, formats, count);
+		break;
+	}
+
+	output.SetCardinality(0);
+	return OperatorResultType::NEED_MORE_INPUT;
+}
+
+OperatorFinalizeResultType WriteFunctionFinal(ExecutionContext &context, TableFunctionInput &data, DataChunk &output) {
+	const auto &bind_data = data.bind_data->Cast<WriteFunctionData>();
+	auto &local_state = data.local_state->Cast<WriteLocalState>();
+
+	FlushBatch(local_state, bind_data);
+	while (!local_state.inflight.empty()) {
+		CompleteBatch(local_state);
+	}
+
+	output.SetValue(0, 0, Value::UBIGINT(local_state.rows_written));
+	output.SetValue(1, 0, Value::UBIGINT(local_state.rows_skipped));
+	output.SetCardinality(1);
+	return OperatorFinalizeResultType::FINISHED;
+}
+
+} // namespace duckdb